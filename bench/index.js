@@ -0,0 +1,294 @@
+// Headless benchmarks for the native bindings.
+//
+// Runs against the dummy video driver, the software renderer and the dummy
+// audio driver, so it needs neither a GPU nor a sound card:
+//
+//   node --expose-gc bench/index.js [--time ms] [--out file]
+//                                   [--baseline file] [--threshold 0.1]
+//                                   [--filter substring]
+//
+// Results are printed as JSON. With --baseline, any benchmark whose rate drops
+// by more than --threshold (a fraction) relative to the baseline fails the run.
+
+import { createRequire } from "node:module";
+import { readFileSync, writeFileSync } from "node:fs";
+import { PerformanceObserver, performance } from "node:perf_hooks";
+
+process.env.SDL_VIDEO_DRIVER ??= "dummy";
+process.env.SDL_RENDER_DRIVER ??= "software";
+process.env.SDL_AUDIO_DRIVER ??= "dummy";
+
+const require = createRequire(import.meta.url);
+const sdl = require("../build/Release/sdl.node");
+
+function parseArgs(argv) {
+  const args = { time: 500, out: null, baseline: null, threshold: 0.1, filter: null };
+  for (let i = 0; i < argv.length; i++) {
+    const key = argv[i].replace(/^--/, "");
+    if (!(key in args)) {
+      throw new Error(`Unknown option ${argv[i]}`);
+    }
+    const value = argv[++i];
+    args[key] = typeof args[key] === "number" ? Number(value) : value;
+  }
+  return args;
+}
+
+let gcCount = 0;
+new PerformanceObserver((list) => {
+  gcCount += list.getEntries().length;
+}).observe({ entryTypes: ["gc"] });
+
+function collect() {
+  if (globalThis.gc) {
+    globalThis.gc();
+  }
+}
+
+// Calls fn() repeatedly for roughly `time` ms. fn returns how many units
+// (calls, primitives, events, bytes) it processed.
+async function measure(name, unit, time, fn) {
+  for (let i = 0; i < 3; i++) {
+    fn();
+  }
+  collect();
+  await new Promise((resolve) => setImmediate(resolve));
+
+  const gcBefore = gcCount;
+  const heapBefore = process.memoryUsage().heapUsed;
+  let units = 0;
+  let iterations = 0;
+  const start = performance.now();
+  let elapsed = 0;
+  while (elapsed < time) {
+    units += fn();
+    iterations++;
+    elapsed = performance.now() - start;
+  }
+  const heapAfter = process.memoryUsage().heapUsed;
+
+  // GC entries are delivered asynchronously.
+  await new Promise((resolve) => setImmediate(resolve));
+
+  return {
+    name,
+    unit,
+    rate: units / (elapsed / 1000),
+    iterations,
+    gcCount: gcCount - gcBefore,
+    heapGrowthPerIteration: (heapAfter - heapBefore) / iterations,
+  };
+}
+
+function setup() {
+  sdl.init(sdl.INIT_VIDEO | sdl.INIT_AUDIO);
+  const window = sdl.createWindow("bench", sdl.WINDOWPOS_CENTERED, sdl.WINDOWPOS_CENTERED, 640, 480, 0);
+  if (!window) {
+    throw new Error(`createWindow failed: ${sdl.getError()}`);
+  }
+  const renderer = sdl.createRenderer(window, null);
+  if (!renderer) {
+    throw new Error(`createRenderer failed: ${sdl.getError()}`);
+  }
+  const stream = sdl.createAudioStream(
+    { format: sdl.AUDIO_F32, channels: 2, freq: 48000 },
+    { format: sdl.AUDIO_S16, channels: 2, freq: 44100 },
+  );
+  if (!stream) {
+    throw new Error(`createAudioStream failed: ${sdl.getError()}`);
+  }
+  return { window, renderer, stream };
+}
+
+function teardown({ window, renderer, stream }) {
+  sdl.destroyAudioStream(stream);
+  sdl.destroyRenderer(renderer);
+  sdl.destroyWindow(window);
+  sdl.quit();
+}
+
+function benchmarks({ renderer, stream }) {
+  const RECTS = 1000;
+  const rect = { x: 10, y: 10, w: 20, h: 20 };
+  const rects = new Float32Array(RECTS * 4);
+  for (let i = 0; i < RECTS; i++) {
+    rects.set([(i * 7) % 600, (i * 13) % 440, 16, 16], i * 4);
+  }
+
+  const commands = new Float32Array(RECTS * 5 + 5);
+  commands.set([sdl.RENDER_CMD_COLOR, 255, 128, 0, 255]);
+  for (let i = 0; i < RECTS; i++) {
+    commands.set([sdl.RENDER_CMD_FILL_RECT, rects[i * 4], rects[i * 4 + 1], 16, 16], 5 + i * 5);
+  }
+
+  const LABELS = 1000;
+  const textCache = sdl.createTextCache(renderer);
+  const labels = Array.from({ length: LABELS }, (_, i) => `label ${i}`);
+  const labelLayout = new Float32Array(LABELS * sdl.TEXT_RECORD_SIZE);
+  for (let i = 0; i < LABELS; i++) {
+    labelLayout.set([(i * 37) % 560, (i * 11) % 470, 1, 1, 1, 1, 1], i * sdl.TEXT_RECORD_SIZE);
+  }
+
+  const displayList = sdl.createDisplayList(renderer, 640, 480);
+  for (let i = 0; i < RECTS; i++) {
+    sdl.displayListSet(displayList, i, {
+      type: sdl.DISPLAY_NODE_FILL_RECT, x: rects[i * 4], y: rects[i * 4 + 1], w: 16, h: 16, g: 128, b: 0,
+    });
+  }
+  let movingFrame = 0;
+
+  const EVENTS = 256;
+  const eventBuffer = new ArrayBuffer(sdl.EVENT_RECORD_SIZE * EVENTS);
+
+  const AUDIO_FRAMES = 4800;
+  const pcm = new Float32Array(AUDIO_FRAMES * 2);
+  for (let i = 0; i < pcm.length; i++) {
+    pcm[i] = Math.sin(i / 20);
+  }
+  const pcmOut = new Uint8Array(pcm.byteLength);
+
+  return [
+    ["setRenderDrawColor", "calls", () => {
+      for (let i = 0; i < 1000; i++) sdl.setRenderDrawColor(renderer, i & 255, 0, 0, 255);
+      return 1000;
+    }],
+    ["renderRect", "primitives", () => {
+      for (let i = 0; i < RECTS; i++) sdl.renderRect(renderer, rect);
+      return RECTS;
+    }],
+    ["renderRects", "primitives", () => {
+      sdl.renderRects(renderer, rects);
+      return RECTS;
+    }],
+    ["renderFillRects", "primitives", () => {
+      sdl.renderFillRects(renderer, rects);
+      return RECTS;
+    }],
+    ["submitRenderCommands", "primitives", () => {
+      sdl.submitRenderCommands(renderer, commands, RECTS + 1);
+      return RECTS;
+    }],
+    ["renderDebugText", "labels", () => {
+      for (let i = 0; i < LABELS; i++) {
+        sdl.renderDebugText(renderer, labelLayout[i * sdl.TEXT_RECORD_SIZE], labelLayout[i * sdl.TEXT_RECORD_SIZE + 1], labels[i]);
+      }
+      return LABELS;
+    }],
+    ["renderCachedText", "labels", () => {
+      sdl.renderCachedText(textCache, labels, labelLayout);
+      return LABELS;
+    }],
+    ["renderDisplayList (one node moved)", "primitives", () => {
+      const x = movingFrame++ % 600;
+      sdl.displayListSet(displayList, 0, { type: sdl.DISPLAY_NODE_FILL_RECT, x, y: 10, w: 16, h: 16, g: 128, b: 0 });
+      sdl.renderDisplayList(displayList);
+      return RECTS;
+    }],
+    ["renderPresent", "calls", () => {
+      sdl.renderClear(renderer);
+      sdl.renderPresent(renderer);
+      return 1;
+    }],
+    ["pollEvent", "events", () => {
+      for (let i = 0; i < EVENTS; i++) sdl.pushEvent(sdl.EVENT_USER, i);
+      let n = 0;
+      while (sdl.pollEvent()) n++;
+      return n;
+    }],
+    ["pollEvents", "events", () => {
+      for (let i = 0; i < EVENTS; i++) sdl.pushEvent(sdl.EVENT_USER, i);
+      let n = 0;
+      let got;
+      while ((got = sdl.pollEvents(eventBuffer)) > 0) n += got;
+      return n;
+    }],
+    ["pollEvents (coalesced motion)", "events", () => {
+      sdl.setEventFilter({});
+      for (let i = 0; i < EVENTS; i++) sdl.pushEvent(sdl.EVENT_MOUSE_MOTION);
+      sdl.pushEvent(sdl.EVENT_USER, 0);
+      while (sdl.pollEvents(eventBuffer) > 0);
+      sdl.setEventFilter(null);
+      return EVENTS + 1;
+    }],
+    ["getAudioStreamData (allocating)", "bytes", () => {
+      sdl.putAudioStreamData(stream, pcm);
+      let result;
+      while ((result = sdl.getAudioStreamData(stream, pcmOut.byteLength)) && result.bytesRead > 0);
+      return pcm.byteLength;
+    }],
+    ["getAudioStreamData (view)", "bytes", () => {
+      sdl.putAudioStreamData(stream, pcm);
+      while (sdl.getAudioStreamData(stream, pcmOut) > 0);
+      return pcm.byteLength;
+    }],
+    ["convertAudio", "bytes", () => {
+      sdl.convertAudio(
+        { format: sdl.AUDIO_F32, channels: 2, freq: 48000 },
+        pcm,
+        { format: sdl.AUDIO_S16, channels: 2, freq: 44100 },
+      );
+      return pcm.byteLength;
+    }],
+  ];
+}
+
+function compare(results, baselinePath, threshold) {
+  const baseline = JSON.parse(readFileSync(baselinePath, "utf8"));
+  const previous = new Map(baseline.results.map((r) => [r.name, r]));
+  const regressions = [];
+  for (const result of results) {
+    const before = previous.get(result.name);
+    if (!before) {
+      continue;
+    }
+    const change = result.rate / before.rate - 1;
+    result.change = change;
+    if (change < -threshold) {
+      regressions.push({ name: result.name, baseline: before.rate, rate: result.rate, change });
+    }
+  }
+  return regressions;
+}
+
+async function main() {
+  const args = parseArgs(process.argv.slice(2));
+  const handles = setup();
+  const results = [];
+  try {
+    for (const [name, unit, fn] of benchmarks(handles)) {
+      if (args.filter && !name.includes(args.filter)) {
+        continue;
+      }
+      results.push(await measure(name, unit, args.time, fn));
+    }
+  } finally {
+    teardown(handles);
+  }
+
+  const report = {
+    node: process.version,
+    platform: `${process.platform}-${process.arch}`,
+    date: new Date().toISOString(),
+    gcExposed: Boolean(globalThis.gc),
+    results,
+  };
+
+  if (args.baseline) {
+    report.regressions = compare(results, args.baseline, args.threshold);
+  }
+
+  const json = JSON.stringify(report, null, 2);
+  if (args.out) {
+    writeFileSync(args.out, json + "\n");
+  }
+  console.log(json);
+
+  if (report.regressions?.length) {
+    for (const r of report.regressions) {
+      console.error(`regression: ${r.name} ${(r.change * 100).toFixed(1)}%`);
+    }
+    process.exitCode = 1;
+  }
+}
+
+await main();
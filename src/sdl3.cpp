@@ -10,11 +10,206 @@
 #include <SDL3/SDL_video.h>
 #include <SDL3/SDL_events.h>
 #include <SDL3/SDL_render.h>
+#include <SDL3/SDL_pixels.h>
 #include <SDL3/SDL_timer.h>
 #include <SDL3/SDL_audio.h>
+#include <SDL3/SDL_iostream.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SDL_NODE_SSE 1
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define SDL_NODE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 using namespace Napi;
 
+// Instrumentation
+//
+// Every exported binding goes through Profiled<>, which costs a single branch
+// until setStatsEnabled(true). Timings use the performance counter and are
+// reported in milliseconds; frame times are the intervals between presents.
+struct Stats;
+
+struct BindingStat {
+  const char* name;
+  const Stats* owner;
+  Uint64 calls;
+  Uint64 ticks;
+  Uint64 maxTicks;
+};
+
+static const int kMaxBindingStats = 256;
+static const int kFrameHistogramBuckets = 64;
+static const double kFrameHistogramBucketMs = 1.0;
+
+struct Stats {
+  bool enabled = false;
+  BindingStat bindings[kMaxBindingStats];
+  int bindingCount = 0;
+  Uint64 audioBytesPut = 0;
+  Uint64 audioBytesGot = 0;
+  Uint64 frames = 0;
+  Uint64 lastPresentTicks = 0;
+  Uint64 frameHistogram[kFrameHistogramBuckets];
+};
+
+// Per-environment state
+//
+// The addon can be loaded by several Node environments at once, the main
+// thread and any worker_threads. Anything that holds JS handles or is only
+// touched from one JS thread lives here, as the env's instance data, rather
+// than in a global.
+struct EventPump;
+struct EventFilter;
+struct FrameLoop;
+struct DisplayList;
+struct TextCache;
+struct AudioStreamPull;
+struct AudioStreamCapture;
+struct AudioStreamMonitor;
+struct Mixer;
+
+struct AddonData {
+  Stats stats;
+  Uint32 initFlags = 0;
+  std::unordered_map<SDL_Texture*, Reference<ArrayBuffer>> lockedTextures;
+  std::unordered_map<SDL_Surface*, ObjectReference> surfaceBuffers;
+  std::unique_ptr<EventPump> eventPump;
+  std::unique_ptr<EventFilter> eventFilter;
+  std::unordered_map<FrameLoop*, bool> frameLoops;
+  std::unordered_map<TextCache*, bool> textCaches;
+  std::unordered_map<DisplayList*, bool> displayLists;
+  std::unordered_map<SDL_AudioStream*, AudioStreamPull*> audioStreamPulls;
+  std::unordered_map<SDL_AudioStream*, AudioStreamCapture*> audioStreamCaptures;
+  std::unordered_map<SDL_AudioStream*, AudioStreamMonitor*> audioStreamMonitors;
+  std::unordered_map<Mixer*, bool> mixers;
+
+  ~AddonData();
+};
+
+static AddonData* GetAddonData(Env env) {
+  return env.GetInstanceData<AddonData>();
+}
+
+static BindingStat* RegisterBindingStat(Stats* stats, const char* name) {
+  for (int i = 0; i < stats->bindingCount; i++) {
+    if (strcmp(stats->bindings[i].name, name) == 0) {
+      return &stats->bindings[i];
+    }
+  }
+  if (stats->bindingCount == kMaxBindingStats) {
+    return nullptr;
+  }
+  BindingStat* stat = &stats->bindings[stats->bindingCount++];
+  *stat = { name, stats, 0, 0, 0 };
+  return stat;
+}
+
+template <Value (*Fn)(const CallbackInfo&)>
+static Value Profiled(const CallbackInfo& info) {
+  BindingStat* stat = static_cast<BindingStat*>(info.Data());
+  if (!stat || !stat->owner->enabled) {
+    return Fn(info);
+  }
+  Uint64 start = SDL_GetPerformanceCounter();
+  Value result = Fn(info);
+  Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+  stat->calls++;
+  stat->ticks += elapsed;
+  stat->maxTicks = SDL_max(stat->maxTicks, elapsed);
+  return result;
+}
+
+static void RecordAudioBytes(Env env, Uint64 Stats::*counter, int bytes) {
+  Stats& stats = GetAddonData(env)->stats;
+  if (stats.enabled && bytes > 0) {
+    stats.*counter += bytes;
+  }
+}
+
+static void RecordPresent(Env env) {
+  Stats& stats = GetAddonData(env)->stats;
+  if (!stats.enabled) {
+    return;
+  }
+  Uint64 now = SDL_GetPerformanceCounter();
+  if (stats.lastPresentTicks != 0) {
+    double ms = (now - stats.lastPresentTicks) * 1000.0 / SDL_GetPerformanceFrequency();
+    int bucket = SDL_min(static_cast<int>(ms / kFrameHistogramBucketMs), kFrameHistogramBuckets - 1);
+    stats.frameHistogram[bucket]++;
+  }
+  stats.lastPresentTicks = now;
+  stats.frames++;
+}
+
+// Main-thread checks
+//
+// Video, rendering and event handling must stay on SDL's main thread, the
+// thread that first initialized SDL. Bindings exported with
+// EXPORT_MAIN_THREAD_BINDING throw instead of calling into SDL from a worker.
+//
+// SDL adopts whichever thread initializes it first, and before that
+// SDL_IsMainThread() is true everywhere, so the addon pins the main thread
+// itself: the thread of the first env to load it, which is Node's main
+// thread. Workers may only init once SDL is already up.
+static const SDL_InitFlags kMainThreadSubsystems =
+    SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_JOYSTICK | SDL_INIT_HAPTIC | SDL_INIT_GAMEPAD | SDL_INIT_SENSOR |
+    SDL_INIT_CAMERA;
+
+static std::atomic<SDL_ThreadID> g_mainThreadID{0};
+
+static bool IsMainThread() {
+  return SDL_GetCurrentThreadID() == g_mainThreadID.load(std::memory_order_relaxed) && SDL_IsMainThread();
+}
+
+template <Value (*Fn)(const CallbackInfo&)>
+static Value MainThreadOnly(const CallbackInfo& info) {
+  if (!IsMainThread()) {
+    Env env = info.Env();
+    Error::New(env, "This function can only be called on the main thread").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  return Fn(info);
+}
+
+// SDL_Init/SDL_Quit across environments
+//
+// Each env quits only the subsystems it initialized itself, and SDL_Quit runs
+// once no env holds any, so a worker exiting doesn't pull SDL out from under
+// the main thread.
+struct SDLInitState {
+  std::mutex mutex;
+  int envs = 0;
+};
+
+static SDLInitState g_sdlInit;
+
+static void QuitEnvSubsystems(AddonData* data) {
+  std::lock_guard<std::mutex> lock(g_sdlInit.mutex);
+  if (data->initFlags == 0) {
+    return;
+  }
+  SDL_QuitSubSystem(data->initFlags);
+  data->initFlags = 0;
+  if (--g_sdlInit.envs == 0) {
+    SDL_Quit();
+  }
+}
+
 // Commenting out extern declarations to avoid linking issues
 // extern void InitAudio(Env env, Object exports);
 // extern void InitGPU(Env env, Object exports);
@@ -28,17 +223,37 @@ Value Wrap_SDL_Init(const CallbackInfo& info) {
     return env.Undefined();
   }
   Uint32 flags = info[0].As<Number>().Uint32Value();
-  bool result = SDL_Init(flags);
+  bool mainThread = IsMainThread();
+  if ((flags & kMainThreadSubsystems) && !mainThread) {
+    Error::New(env, "Video, event and input subsystems can only be initialized on the main thread").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // Only subsystems this env hasn't initialized yet take a reference, so
+  // quit() can hand back exactly what init() took.
+  AddonData* data = GetAddonData(env);
+  std::lock_guard<std::mutex> lock(g_sdlInit.mutex);
+  if (!mainThread && g_sdlInit.envs == 0) {
+    // A worker initializing first would become SDL's main thread.
+    Error::New(env, "SDL must be initialized on the main thread before any worker").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  Uint32 added = flags & ~data->initFlags;
+  bool result = SDL_Init(added);
   if (!result) {
     Error::New(env, SDL_GetError()).ThrowAsJavaScriptException();
     return env.Undefined();
   }
+  if (added != 0 && data->initFlags == 0) {
+    g_sdlInit.envs++;
+  }
+  data->initFlags |= added;
   return Boolean::New(env, result);
 }
 
 Value Wrap_SDL_Quit(const CallbackInfo& info) {
   Env env = info.Env();
-  SDL_Quit();
+  QuitEnvSubsystems(GetAddonData(env));
   return env.Undefined();
 }
 
@@ -114,6 +329,9 @@ Value Wrap_SDL_CreateRenderer(const CallbackInfo& info) {
   return Number::New(env, reinterpret_cast<uintptr_t>(renderer));
 }
 
+static void DetachRendererTextures(Env env, SDL_Renderer* renderer);
+static void ForgetRendererCaptures(SDL_Renderer* renderer);
+
 Value Wrap_SDL_DestroyRenderer(const CallbackInfo& info) {
   Env env = info.Env();
   if (info.Length() != 1 || !info[0].IsNumber()) {
@@ -122,6 +340,8 @@ Value Wrap_SDL_DestroyRenderer(const CallbackInfo& info) {
   }
 
   SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  DetachRendererTextures(env, renderer);
+  ForgetRendererCaptures(renderer);
   SDL_DestroyRenderer(renderer);
   return env.Undefined();
 }
@@ -185,274 +405,3727 @@ Value Wrap_SDL_RenderPresent(const CallbackInfo& info) {
 
   SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
   bool result = SDL_RenderPresent(renderer);
+  RecordPresent(env);
   return Boolean::New(env, result);
 }
 
-Value Wrap_SDL_PollEvent(const CallbackInfo& info) {
-  Env env = info.Env();
-  SDL_Event event;
-  bool result = SDL_PollEvent(&event);
-  if (result) {
-    Object jsEvent = Object::New(env);
-    jsEvent.Set("type", Number::New(env, event.type));
-    return jsEvent;
+// Resolves the bytes behind an ArrayBuffer, TypedArray or DataView. Views may
+// be backed by a SharedArrayBuffer, which napi can't expose as an ArrayBuffer,
+// so the raw view info is used instead of ArrayBuffer::Data().
+static bool GetBufferData(const Value& value, void** data, size_t* length) {
+  napi_env env = value.Env();
+  if (value.IsTypedArray()) {
+    napi_typedarray_type type;
+    size_t elements;
+    if (napi_get_typedarray_info(env, value, &type, &elements, data, nullptr, nullptr) != napi_ok) {
+      return false;
+    }
+    *length = value.As<TypedArray>().ByteLength();
+    return true;
   }
-  return env.Null();
+  if (value.IsDataView()) {
+    return napi_get_dataview_info(env, value, length, data, nullptr, nullptr) == napi_ok;
+  }
+  if (value.IsArrayBuffer()) {
+    return napi_get_arraybuffer_info(env, value, data, length) == napi_ok;
+  }
+  return false;
 }
 
-// Similar wrappers for other basics functions like SDL_InitSubSystem, SDL_QuitSubSystem, SDL_WasInit, SDL_IsMainThread, SDL_RunOnMainThread, SDL_SetAppMetadata, SDL_SetAppMetadataProperty, SDL_GetAppMetadataProperty
-
-Value Wrap_SDL_SetHintWithPriority(const CallbackInfo& info) {
-  Env env = info.Env();
-  if (info.Length() != 3 || !info[0].IsString() || !info[1].IsString() || !info[2].IsNumber()) {
-    TypeError::New(env, "Expected string, string, number").ThrowAsJavaScriptException();
-    return env.Undefined();
+// Hands an SDL allocation to JS without copying: the ArrayBuffer points at
+// SDL's memory and frees it when collected.
+static ArrayBuffer NewSDLOwnedArrayBuffer(Env env, Uint8* data, size_t length) {
+  if (length == 0) {
+    SDL_free(data);
+    return ArrayBuffer::New(env, 0);
   }
-  std::string name = info[0].As<String>().Utf8Value();
-  std::string value = info[1].As<String>().Utf8Value();
-  SDL_HintPriority priority = static_cast<SDL_HintPriority>(info[2].As<Number>().Int32Value());
-  return Boolean::New(env, SDL_SetHintWithPriority(name.c_str(), value.c_str(), priority));
+  return ArrayBuffer::New(env, data, length, [](Env, void* data) { SDL_free(data); });
 }
 
-// Similar wrappers for other hints, properties, error, log, assert, version functions based on the signatures.
-
-// Audio Device Functions
-Value Wrap_SDL_OpenAudioDevice(const CallbackInfo& info) {
-  Env env = info.Env();
-  if (info.Length() < 1 || !info[0].IsObject()) {
-    TypeError::New(env, "Expected audio spec object").ThrowAsJavaScriptException();
-    return env.Undefined();
+// Reads an optional byte offset and length at info[index] and info[index + 1]
+// and narrows [data, data + length) to that range.
+static bool GetBufferRange(const CallbackInfo& info, size_t index, void** data, size_t* length) {
+  size_t offset = 0;
+  size_t available = *length;
+  if (info.Length() > index) {
+    if (!info[index].IsNumber()) {
+      TypeError::New(info.Env(), "Expected byte offset").ThrowAsJavaScriptException();
+      return false;
+    }
+    offset = static_cast<size_t>(info[index].As<Number>().Int64Value());
+  }
+  if (offset > available) {
+    RangeError::New(info.Env(), "Byte offset exceeds buffer length").ThrowAsJavaScriptException();
+    return false;
   }
+  size_t len = available - offset;
+  if (info.Length() > index + 1) {
+    if (!info[index + 1].IsNumber()) {
+      TypeError::New(info.Env(), "Expected byte length").ThrowAsJavaScriptException();
+      return false;
+    }
+    len = static_cast<size_t>(info[index + 1].As<Number>().Int64Value());
+    if (len > available - offset) {
+      RangeError::New(info.Env(), "Byte range exceeds buffer length").ThrowAsJavaScriptException();
+      return false;
+    }
+  }
+  *data = static_cast<Uint8*>(*data) + offset;
+  *length = len;
+  return true;
+}
 
-  Object specObj = info[0].As<Object>();
-  SDL_AudioSpec spec;
-  spec.format = static_cast<SDL_AudioFormat>(specObj.Get("format").As<Number>().Uint32Value());
-  spec.channels = specObj.Get("channels").As<Number>().Int32Value();
-  spec.freq = specObj.Get("freq").As<Number>().Int32Value();
+// Render command buffer
+//
+// Commands are packed into a Float32Array as an opcode followed by its
+// operands, so a whole frame can be submitted with one native call:
+//   COLOR r g b a | CLEAR | RECT x y w h | FILL_RECT x y w h |
+//   LINE x1 y1 x2 y2 | POINT x y | PRESENT | CLIP x y w h | VIEWPORT x y w h
+// A negative width for CLIP or VIEWPORT resets it to the full target.
+enum RenderCommand {
+  RENDER_CMD_COLOR = 0,
+  RENDER_CMD_CLEAR,
+  RENDER_CMD_RECT,
+  RENDER_CMD_FILL_RECT,
+  RENDER_CMD_LINE,
+  RENDER_CMD_POINT,
+  RENDER_CMD_PRESENT,
+  RENDER_CMD_CLIP,
+  RENDER_CMD_VIEWPORT,
+  RENDER_CMD_COUNT
+};
 
-  SDL_AudioDeviceID devid = info.Length() > 1 ? info[1].As<Number>().Uint32Value() : SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK;
+static const int kRenderCommandOperands[RENDER_CMD_COUNT] = { 4, 0, 4, 4, 4, 2, 0, 4, 4 };
 
-  SDL_AudioDeviceID device = SDL_OpenAudioDevice(devid, &spec);
-  if (device == 0) {
-    return env.Null();
+static bool GetFloatData(const Value& value, const float** data, size_t* length) {
+  if (value.IsTypedArray()) {
+    TypedArray array = value.As<TypedArray>();
+    if (array.TypedArrayType() != napi_float32_array) {
+      return false;
+    }
+    *data = value.As<Float32Array>().Data();
+    *length = array.ElementLength();
+    return true;
+  }
+  if (value.IsArrayBuffer()) {
+    ArrayBuffer buffer = value.As<ArrayBuffer>();
+    *data = static_cast<const float*>(buffer.Data());
+    *length = buffer.ByteLength() / sizeof(float);
+    return true;
   }
+  return false;
+}
 
-  return Number::New(env, device);
+// Float to integer casts are undefined for NaN and out-of-range values, so
+// command operands are clamped first; NaN becomes 0.
+static Uint8 ToColorComponent(float value) {
+  return value > 0.0f ? static_cast<Uint8>(SDL_min(value, 255.0f)) : 0;
 }
 
-Value Wrap_SDL_CloseAudioDevice(const CallbackInfo& info) {
+static int ToRectCoordinate(float value) {
+  const float limit = 1073741824.0f;  // 2^30, well inside int and exact as a float
+  return value == value ? static_cast<int>(SDL_clamp(value, -limit, limit)) : 0;
+}
+
+static bool SetRenderRectCommand(SDL_Renderer* renderer, int op, const float* args) {
+  SDL_Rect rect = { ToRectCoordinate(args[0]), ToRectCoordinate(args[1]),
+                    ToRectCoordinate(args[2]), ToRectCoordinate(args[3]) };
+  const SDL_Rect* rectPtr = args[2] < 0 ? nullptr : &rect;
+  return op == RENDER_CMD_CLIP ? SDL_SetRenderClipRect(renderer, rectPtr)
+                               : SDL_SetRenderViewport(renderer, rectPtr);
+}
+
+Value Wrap_SubmitRenderCommands(const CallbackInfo& info) {
   Env env = info.Env();
-  if (info.Length() != 1 || !info[0].IsNumber()) {
-    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
+  const float* data = nullptr;
+  size_t length = 0;
+  if (info.Length() != 3 || !info[0].IsNumber() || !GetFloatData(info[1], &data, &length) ||
+      !info[2].IsNumber()) {
+    TypeError::New(env, "Expected renderer, Float32Array or ArrayBuffer, command count").ThrowAsJavaScriptException();
     return env.Undefined();
   }
 
-  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
-  SDL_CloseAudioDevice(devid);
-  return env.Undefined();
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  Uint32 count = info[2].As<Number>().Uint32Value();
+
+  Uint32 executed = 0;
+  Uint32 failed = 0;
+  int firstErrorIndex = -1;
+  std::string firstError;
+  bool malformed = false;
+  size_t pos = 0;
+
+  for (; executed < count; executed++) {
+    if (pos >= length) {
+      malformed = true;
+      break;
+    }
+    // Written so NaN fails the range test too.
+    if (!(data[pos] >= 0 && data[pos] < RENDER_CMD_COUNT)) {
+      malformed = true;
+      break;
+    }
+    int op = static_cast<int>(data[pos]);
+    if (pos + 1 + kRenderCommandOperands[op] > length) {
+      malformed = true;
+      break;
+    }
+    const float* args = data + pos + 1;
+    pos += 1 + kRenderCommandOperands[op];
+
+    bool ok = true;
+    switch (op) {
+      case RENDER_CMD_COLOR:
+        ok = SDL_SetRenderDrawColor(renderer, ToColorComponent(args[0]), ToColorComponent(args[1]),
+                                    ToColorComponent(args[2]), ToColorComponent(args[3]));
+        break;
+      case RENDER_CMD_CLEAR:
+        ok = SDL_RenderClear(renderer);
+        break;
+      case RENDER_CMD_RECT:
+      case RENDER_CMD_FILL_RECT: {
+        SDL_FRect rect = { args[0], args[1], args[2], args[3] };
+        ok = op == RENDER_CMD_RECT ? SDL_RenderRect(renderer, &rect) : SDL_RenderFillRect(renderer, &rect);
+        break;
+      }
+      case RENDER_CMD_LINE:
+        ok = SDL_RenderLine(renderer, args[0], args[1], args[2], args[3]);
+        break;
+      case RENDER_CMD_POINT:
+        ok = SDL_RenderPoint(renderer, args[0], args[1]);
+        break;
+      case RENDER_CMD_PRESENT:
+        ok = SDL_RenderPresent(renderer);
+        RecordPresent(env);
+        break;
+      case RENDER_CMD_CLIP:
+      case RENDER_CMD_VIEWPORT:
+        ok = SetRenderRectCommand(renderer, op, args);
+        break;
+    }
+
+    if (!ok) {
+      if (failed == 0) {
+        firstErrorIndex = executed;
+        firstError = SDL_GetError();
+      }
+      failed++;
+    }
+  }
+
+  Object returnObj = Object::New(env);
+  returnObj.Set("executed", Number::New(env, executed));
+  returnObj.Set("failed", Number::New(env, failed));
+  returnObj.Set("firstErrorIndex", Number::New(env, firstErrorIndex));
+  returnObj.Set("error", failed > 0 ? static_cast<Value>(String::New(env, firstError)) : env.Null());
+  returnObj.Set("malformed", Boolean::New(env, malformed));
+  return returnObj;
 }
 
-Value Wrap_SDL_GetAudioDeviceName(const CallbackInfo& info) {
+// Bulk primitive drawing
+//
+// The Float32Array backing store is handed straight to SDL as an array of
+// SDL_FRect (x, y, w, h) or SDL_FPoint (x, y). Offset and count are in
+// primitives, not floats; count defaults to everything after offset.
+static bool GetPrimitiveRange(const CallbackInfo& info, size_t stride, const float** first, int* count) {
   Env env = info.Env();
-  if (info.Length() != 1 || !info[0].IsNumber()) {
-    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
-    return env.Undefined();
+  const float* data = nullptr;
+  size_t length = 0;
+  if (info.Length() < 2 || info.Length() > 4 || !info[0].IsNumber() || !GetFloatData(info[1], &data, &length) ||
+      (info.Length() > 2 && !info[2].IsNumber()) || (info.Length() > 3 && !info[3].IsNumber())) {
+    TypeError::New(env, "Expected renderer, Float32Array, optional offset, optional count").ThrowAsJavaScriptException();
+    return false;
   }
 
-  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
-  const char* name = SDL_GetAudioDeviceName(devid);
-  if (!name) {
-    return env.Null();
+  size_t total = length / stride;
+  size_t offset = info.Length() > 2 ? info[2].As<Number>().Uint32Value() : 0;
+  size_t n = info.Length() > 3 ? info[3].As<Number>().Uint32Value() : (offset < total ? total - offset : 0);
+  if (offset > total || n > total - offset || n > static_cast<size_t>(SDL_MAX_SINT32)) {
+    RangeError::New(env, "Offset and count exceed the array length").ThrowAsJavaScriptException();
+    return false;
   }
-  return String::New(env, name);
+
+  *first = data + offset * stride;
+  *count = static_cast<int>(n);
+  return true;
 }
 
-Value Wrap_SDL_PauseAudioDevice(const CallbackInfo& info) {
+Value Wrap_SDL_RenderRects(const CallbackInfo& info) {
   Env env = info.Env();
-  if (info.Length() != 1 || !info[0].IsNumber()) {
-    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
+  const float* first;
+  int count;
+  if (!GetPrimitiveRange(info, 4, &first, &count)) {
     return env.Undefined();
   }
 
-  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
-  bool result = SDL_PauseAudioDevice(devid);
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  bool result = SDL_RenderRects(renderer, reinterpret_cast<const SDL_FRect*>(first), count);
   return Boolean::New(env, result);
 }
 
-Value Wrap_SDL_ResumeAudioDevice(const CallbackInfo& info) {
+Value Wrap_SDL_RenderFillRects(const CallbackInfo& info) {
   Env env = info.Env();
-  if (info.Length() != 1 || !info[0].IsNumber()) {
-    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
+  const float* first;
+  int count;
+  if (!GetPrimitiveRange(info, 4, &first, &count)) {
     return env.Undefined();
   }
 
-  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
-  bool result = SDL_ResumeAudioDevice(devid);
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  bool result = SDL_RenderFillRects(renderer, reinterpret_cast<const SDL_FRect*>(first), count);
   return Boolean::New(env, result);
 }
 
-Value Wrap_SDL_AudioDevicePaused(const CallbackInfo& info) {
+Value Wrap_SDL_RenderLines(const CallbackInfo& info) {
   Env env = info.Env();
-  if (info.Length() != 1 || !info[0].IsNumber()) {
-    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
+  const float* first;
+  int count;
+  if (!GetPrimitiveRange(info, 2, &first, &count)) {
     return env.Undefined();
   }
 
-  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
-  bool result = SDL_AudioDevicePaused(devid);
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  bool result = SDL_RenderLines(renderer, reinterpret_cast<const SDL_FPoint*>(first), count);
   return Boolean::New(env, result);
 }
 
-Value Wrap_SDL_SetAudioDeviceGain(const CallbackInfo& info) {
+Value Wrap_SDL_RenderPoints(const CallbackInfo& info) {
   Env env = info.Env();
-  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
-    TypeError::New(env, "Expected device ID and gain").ThrowAsJavaScriptException();
+  const float* first;
+  int count;
+  if (!GetPrimitiveRange(info, 2, &first, &count)) {
     return env.Undefined();
   }
 
-  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
-  float gain = info[1].As<Number>().FloatValue();
-  bool result = SDL_SetAudioDeviceGain(devid, gain);
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  bool result = SDL_RenderPoints(renderer, reinterpret_cast<const SDL_FPoint*>(first), count);
   return Boolean::New(env, result);
 }
 
-Value Wrap_SDL_GetAudioDeviceGain(const CallbackInfo& info) {
-  Env env = info.Env();
-  if (info.Length() != 1 || !info[0].IsNumber()) {
-    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
-    return env.Undefined();
+// Texture functions
+static bool GetOptionalRect(const Value& value, SDL_Rect* rect, const SDL_Rect** rectPtr) {
+  if (value.IsNull() || value.IsUndefined()) {
+    *rectPtr = nullptr;
+    return true;
+  }
+  if (!value.IsObject()) {
+    return false;
   }
+  Object rectObj = value.As<Object>();
+  rect->x = rectObj.Get("x").As<Number>().Int32Value();
+  rect->y = rectObj.Get("y").As<Number>().Int32Value();
+  rect->w = rectObj.Get("w").As<Number>().Int32Value();
+  rect->h = rectObj.Get("h").As<Number>().Int32Value();
+  *rectPtr = rect;
+  return true;
+}
 
-  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
-  float gain = SDL_GetAudioDeviceGain(devid);
-  return Number::New(env, gain);
+static bool GetOptionalFRect(const Value& value, SDL_FRect* rect, const SDL_FRect** rectPtr) {
+  if (value.IsNull() || value.IsUndefined()) {
+    *rectPtr = nullptr;
+    return true;
+  }
+  if (!value.IsObject()) {
+    return false;
+  }
+  Object rectObj = value.As<Object>();
+  rect->x = rectObj.Get("x").As<Number>().FloatValue();
+  rect->y = rectObj.Get("y").As<Number>().FloatValue();
+  rect->w = rectObj.Get("w").As<Number>().FloatValue();
+  rect->h = rectObj.Get("h").As<Number>().FloatValue();
+  *rectPtr = rect;
+  return true;
 }
 
-// Audio Stream Functions
-Value Wrap_SDL_CreateAudioStream(const CallbackInfo& info) {
-  Env env = info.Env();
-  if (info.Length() != 2 || !info[0].IsObject() || !info[1].IsObject()) {
-    TypeError::New(env, "Expected src and dst audio spec objects").ThrowAsJavaScriptException();
-    return env.Undefined();
+static bool GetTextureArea(SDL_Texture* texture, const SDL_Rect* rect, int* w, int* h) {
+  if (rect) {
+    *w = rect->w;
+    *h = rect->h;
+    return true;
   }
+  float fw, fh;
+  if (!SDL_GetTextureSize(texture, &fw, &fh)) {
+    return false;
+  }
+  *w = static_cast<int>(fw);
+  *h = static_cast<int>(fh);
+  return true;
+}
 
-  Object srcSpecObj = info[0].As<Object>();
-  Object dstSpecObj = info[1].As<Object>();
+// Pixel buffer sizing
+//
+// Everything is computed in size_t so large dimensions can't wrap an int.
+static bool IsPlanarYUVFormat(SDL_PixelFormat format) {
+  return format == SDL_PIXELFORMAT_YV12 || format == SDL_PIXELFORMAT_IYUV || format == SDL_PIXELFORMAT_NV12 ||
+         format == SDL_PIXELFORMAT_NV21 || format == SDL_PIXELFORMAT_P010;
+}
 
-  SDL_AudioSpec srcSpec, dstSpec;
-  srcSpec.format = static_cast<SDL_AudioFormat>(srcSpecObj.Get("format").As<Number>().Uint32Value());
-  srcSpec.channels = srcSpecObj.Get("channels").As<Number>().Int32Value();
-  srcSpec.freq = srcSpecObj.Get("freq").As<Number>().Int32Value();
+// Bytes in one row of w pixels of a packed format, or 0 for planar and other
+// FOURCC formats whose rows aren't a fixed number of bytes per pixel.
+static size_t GetPackedRowBytes(SDL_PixelFormat format, int w) {
+  if (w <= 0 || IsPlanarYUVFormat(format)) {
+    return 0;
+  }
+  if (SDL_ISPIXELFORMAT_FOURCC(format)) {
+    bool packedYUV = format == SDL_PIXELFORMAT_YUY2 || format == SDL_PIXELFORMAT_UYVY || format == SDL_PIXELFORMAT_YVYU;
+    return packedYUV ? (static_cast<size_t>(w) + 1) / 2 * 4 : 0;
+  }
+  return static_cast<size_t>(w) * SDL_BYTESPERPIXEL(format);
+}
 
-  dstSpec.format = static_cast<SDL_AudioFormat>(dstSpecObj.Get("format").As<Number>().Uint32Value());
-  dstSpec.channels = dstSpecObj.Get("channels").As<Number>().Int32Value();
-  dstSpec.freq = dstSpecObj.Get("freq").As<Number>().Int32Value();
+// Whether length bytes hold rows rows of rowBytes each, pitch bytes apart.
+// The last row needn't be padded out to the pitch.
+static bool HasPixelRows(size_t rowBytes, int rows, int pitch, size_t length) {
+  return rowBytes > 0 && rows > 0 && pitch > 0 && static_cast<size_t>(pitch) >= rowBytes &&
+         length >= static_cast<size_t>(pitch) * (rows - 1) + rowBytes;
+}
 
-  SDL_AudioStream* stream = SDL_CreateAudioStream(&srcSpec, &dstSpec);
-  if (!stream) {
-    return env.Null();
+// Size of an 8-bit planar YUV image as SDL's update and lock paths lay it out:
+// h rows of Y at pitch, then (h + 1) / 2 rows of chroma, either two planes at
+// (pitch + 1) / 2 or one interleaved plane at twice that. 0 for P010, whose
+// chroma layout isn't derived from the pitch this way.
+static size_t GetPlanarImageSize(SDL_PixelFormat format, int pitch, int h) {
+  if (format == SDL_PIXELFORMAT_P010 || pitch <= 0 || h <= 0) {
+    return 0;
   }
+  size_t chromaPitch = (static_cast<size_t>(pitch) + 1) / 2;
+  size_t chromaRows = (static_cast<size_t>(h) + 1) / 2;
+  return static_cast<size_t>(pitch) * h + 2 * chromaPitch * chromaRows;
+}
 
-  return Number::New(env, reinterpret_cast<uintptr_t>(stream));
+// Whether length bytes hold a w x h image in format at pitch, chroma planes
+// included. Unknown FOURCC formats and P010 never fit.
+static bool HasPixelImage(SDL_PixelFormat format, int w, int h, int pitch, size_t length) {
+  if (IsPlanarYUVFormat(format)) {
+    size_t size = GetPlanarImageSize(format, pitch, h);
+    return size > 0 && w > 0 && pitch >= w && length >= size;
+  }
+  return HasPixelRows(GetPackedRowBytes(format, w), h, pitch, length);
 }
 
-Value Wrap_SDL_DestroyAudioStream(const CallbackInfo& info) {
-  Env env = info.Env();
-  if (info.Length() != 1 || !info[0].IsNumber()) {
-    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
-    return env.Undefined();
+// Tightly packed pitch for w pixels of format, or 0 if there isn't one that
+// fits an int.
+static int GetDefaultPitch(SDL_PixelFormat format, int w) {
+  size_t pitch = IsPlanarYUVFormat(format) ? static_cast<size_t>(SDL_max(w, 0)) : GetPackedRowBytes(format, w);
+  return pitch <= SDL_MAX_SINT32 ? static_cast<int>(pitch) : 0;
+}
+
+// Buffers handed out by lockTexture (AddonData::lockedTextures), detached
+// again on unlock so JS can't touch the pixel memory once SDL owns it again.
+static void DetachLockedTexture(Env env, SDL_Texture* texture) {
+  std::unordered_map<SDL_Texture*, Reference<ArrayBuffer>>& lockedTextures = GetAddonData(env)->lockedTextures;
+  auto it = lockedTextures.find(texture);
+  if (it == lockedTextures.end()) {
+    return;
+  }
+  ArrayBuffer buffer = it->second.Value();
+  if (!buffer.IsDetached()) {
+    buffer.Detach();
   }
+  lockedTextures.erase(it);
+}
 
-  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
-  SDL_DestroyAudioStream(stream);
-  return env.Undefined();
+// The renderer frees its textures, so lockTexture buffers into them must go.
+static void DetachRendererTextures(Env env, SDL_Renderer* renderer) {
+  std::vector<SDL_Texture*> textures;
+  for (const auto& entry : GetAddonData(env)->lockedTextures) {
+    if (SDL_GetRendererFromTexture(entry.first) == renderer) {
+      textures.push_back(entry.first);
+    }
+  }
+  for (SDL_Texture* texture : textures) {
+    DetachLockedTexture(env, texture);
+  }
 }
 
-Value Wrap_SDL_BindAudioStream(const CallbackInfo& info) {
+Value Wrap_SDL_CreateTexture(const CallbackInfo& info) {
   Env env = info.Env();
-  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
-    TypeError::New(env, "Expected device ID and stream pointer").ThrowAsJavaScriptException();
+  if (info.Length() != 5 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber() ||
+      !info[3].IsNumber() || !info[4].IsNumber()) {
+    TypeError::New(env, "Expected renderer, format, access, w, h").ThrowAsJavaScriptException();
     return env.Undefined();
   }
 
-  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
-  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[1].As<Number>().Int64Value());
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  SDL_PixelFormat format = static_cast<SDL_PixelFormat>(info[1].As<Number>().Uint32Value());
+  SDL_TextureAccess access = static_cast<SDL_TextureAccess>(info[2].As<Number>().Int32Value());
+  int w = info[3].As<Number>().Int32Value();
+  int h = info[4].As<Number>().Int32Value();
 
-  bool result = SDL_BindAudioStream(devid, stream);
-  return Boolean::New(env, result);
+  SDL_Texture* texture = SDL_CreateTexture(renderer, format, access, w, h);
+  if (!texture) {
+    return env.Null();
+  }
+
+  return Number::New(env, reinterpret_cast<uintptr_t>(texture));
 }
 
-Value Wrap_SDL_UnbindAudioStream(const CallbackInfo& info) {
+Value Wrap_SDL_DestroyTexture(const CallbackInfo& info) {
   Env env = info.Env();
   if (info.Length() != 1 || !info[0].IsNumber()) {
-    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    TypeError::New(env, "Expected texture").ThrowAsJavaScriptException();
     return env.Undefined();
   }
 
-  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
-  SDL_UnbindAudioStream(stream);
+  SDL_Texture* texture = reinterpret_cast<SDL_Texture*>(info[0].As<Number>().Int64Value());
+  DetachLockedTexture(env, texture);
+  SDL_DestroyTexture(texture);
   return env.Undefined();
 }
 
-Value Wrap_SDL_PutAudioStreamData(const CallbackInfo& info) {
+Value Wrap_SDL_UpdateTexture(const CallbackInfo& info) {
   Env env = info.Env();
-  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsArrayBuffer()) {
-    TypeError::New(env, "Expected stream pointer and ArrayBuffer").ThrowAsJavaScriptException();
+  SDL_Rect rect;
+  const SDL_Rect* rectPtr;
+  void* pixels = nullptr;
+  size_t length = 0;
+  if (info.Length() != 4 || !info[0].IsNumber() || !GetOptionalRect(info[1], &rect, &rectPtr) ||
+      !GetBufferData(info[2], &pixels, &length) || !info[3].IsNumber()) {
+    TypeError::New(env, "Expected texture, rect or null, pixel buffer, pitch").ThrowAsJavaScriptException();
     return env.Undefined();
   }
 
-  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
-  ArrayBuffer buffer = info[1].As<ArrayBuffer>();
+  SDL_Texture* texture = reinterpret_cast<SDL_Texture*>(info[0].As<Number>().Int64Value());
+  int pitch = info[3].As<Number>().Int32Value();
+  int w, h;
+  if (!GetTextureArea(texture, rectPtr, &w, &h)) {
+    return Boolean::New(env, false);
+  }
+  if (IsPlanarYUVFormat(texture->format)) {
+    // SDL reads the chroma planes from the same buffer, right after h full
+    // rows of Y.
+    size_t size = GetPlanarImageSize(texture->format, pitch, h);
+    if (size == 0 || pitch < w || length < size) {
+      RangeError::New(env, "Pixel buffer is smaller than the planar image at this pitch").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+  } else if (!HasPixelRows(GetPackedRowBytes(texture->format, w), h, pitch, length)) {
+    RangeError::New(env, "Pitch is shorter than a row or the pixel buffer is too small").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
 
-  bool result = SDL_PutAudioStreamData(stream, buffer.Data(), buffer.ByteLength());
+  bool result = SDL_UpdateTexture(texture, rectPtr, pixels, pitch);
   return Boolean::New(env, result);
 }
 
-Value Wrap_SDL_GetAudioStreamData(const CallbackInfo& info) {
+Value Wrap_SDL_UpdateYUVTexture(const CallbackInfo& info) {
   Env env = info.Env();
-  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
-    TypeError::New(env, "Expected stream pointer and buffer size").ThrowAsJavaScriptException();
+  SDL_Rect rect;
+  const SDL_Rect* rectPtr;
+  void* planes[3];
+  size_t lengths[3];
+  if (info.Length() != 8 || !info[0].IsNumber() || !GetOptionalRect(info[1], &rect, &rectPtr) ||
+      !GetBufferData(info[2], &planes[0], &lengths[0]) || !info[3].IsNumber() ||
+      !GetBufferData(info[4], &planes[1], &lengths[1]) || !info[5].IsNumber() ||
+      !GetBufferData(info[6], &planes[2], &lengths[2]) || !info[7].IsNumber()) {
+    TypeError::New(env, "Expected texture, rect or null, Y, Ypitch, U, Upitch, V, Vpitch").ThrowAsJavaScriptException();
     return env.Undefined();
   }
 
-  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
-  int len = info[1].As<Number>().Int32Value();
+  SDL_Texture* texture = reinterpret_cast<SDL_Texture*>(info[0].As<Number>().Int64Value());
+  int pitches[3] = { info[3].As<Number>().Int32Value(), info[5].As<Number>().Int32Value(),
+                     info[7].As<Number>().Int32Value() };
+  int w, h;
+  if (!GetTextureArea(texture, rectPtr, &w, &h)) {
+    return Boolean::New(env, false);
+  }
+  if (w <= 0 || h <= 0) {
+    RangeError::New(env, "Update rect must not be empty").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  for (int i = 0; i < 3; i++) {
+    size_t rowBytes = i == 0 ? static_cast<size_t>(w) : (static_cast<size_t>(w) + 1) / 2;
+    int planeRows = i == 0 ? h : (h + 1) / 2;
+    if (!HasPixelRows(rowBytes, planeRows, pitches[i], lengths[i])) {
+      RangeError::New(env, "Plane pitch is shorter than a row or the plane buffer is too small").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+  }
+
+  bool result = SDL_UpdateYUVTexture(texture, rectPtr,
+                                     static_cast<const Uint8*>(planes[0]), pitches[0],
+                                     static_cast<const Uint8*>(planes[1]), pitches[1],
+                                     static_cast<const Uint8*>(planes[2]), pitches[2]);
+  return Boolean::New(env, result);
+}
+
+// Returns { buffer, pitch } where buffer aliases the locked pixel memory. The
+// buffer is detached by unlockTexture and must not be retained past it.
+Value Wrap_SDL_LockTexture(const CallbackInfo& info) {
+  Env env = info.Env();
+  SDL_Rect rect;
+  const SDL_Rect* rectPtr;
+  if (info.Length() < 1 || info.Length() > 2 || !info[0].IsNumber() ||
+      (info.Length() == 2 && !GetOptionalRect(info[1], &rect, &rectPtr))) {
+    TypeError::New(env, "Expected texture and optional rect").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (info.Length() == 1) {
+    rectPtr = nullptr;
+  }
 
-  ArrayBuffer buffer = ArrayBuffer::New(env, len);
-  int result = SDL_GetAudioStreamData(stream, buffer.Data(), len);
+  SDL_Texture* texture = reinterpret_cast<SDL_Texture*>(info[0].As<Number>().Int64Value());
+  int w, h;
+  if (!GetTextureArea(texture, rectPtr, &w, &h)) {
+    return env.Null();
+  }
+  if (w <= 0 || h <= 0 ||
+      (rectPtr && (rect.x < 0 || rect.y < 0 || rect.x > texture->w - w || rect.y > texture->h - h))) {
+    RangeError::New(env, "Lock rect must be non-empty and inside the texture").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  bool planar = IsPlanarYUVFormat(texture->format);
+  if (planar && (texture->format == SDL_PIXELFORMAT_P010 ||
+                 (rectPtr && (rect.x != 0 || rect.y != 0 || rect.w != texture->w || rect.h != texture->h)))) {
+    // A sub-rect lock points into the middle of the Y plane, and the chroma
+    // planes don't follow it at a size JS could be given safely.
+    RangeError::New(env, "Planar YUV textures can only be locked whole, and P010 not at all").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  size_t rowBytes = planar ? 0 : GetPackedRowBytes(texture->format, w);
+  if (!planar && rowBytes == 0) {
+    RangeError::New(env, "Texture format has no fixed row size to lock").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
 
-  if (result < 0) {
+  void* pixels;
+  int pitch;
+  if (!SDL_LockTexture(texture, rectPtr, &pixels, &pitch)) {
     return env.Null();
   }
 
-  // Return both the buffer and actual bytes read
+  // For planar formats the buffer spans the Y plane and the chroma after it.
+  // A packed sub-rect lock starts x pixels into its first row, so the last
+  // row stops after the rect's own bytes rather than a whole pitch.
+  size_t size = planar ? GetPlanarImageSize(texture->format, pitch, h)
+                       : static_cast<size_t>(pitch) * (h - 1) + rowBytes;
+  DetachLockedTexture(env, texture);
+  ArrayBuffer buffer = ArrayBuffer::New(env, pixels, size);
+  GetAddonData(env)->lockedTextures[texture] = Reference<ArrayBuffer>::New(buffer, 1);
+
   Object returnObj = Object::New(env);
   returnObj.Set("buffer", buffer);
-  returnObj.Set("bytesRead", Number::New(env, result));
+  returnObj.Set("pitch", Number::New(env, pitch));
   return returnObj;
 }
 
-Value Wrap_SDL_GetAudioStreamAvailable(const CallbackInfo& info) {
+Value Wrap_SDL_UnlockTexture(const CallbackInfo& info) {
   Env env = info.Env();
   if (info.Length() != 1 || !info[0].IsNumber()) {
-    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    TypeError::New(env, "Expected texture").ThrowAsJavaScriptException();
     return env.Undefined();
   }
 
-  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
-  int available = SDL_GetAudioStreamAvailable(stream);
-  return Number::New(env, available);
+  SDL_Texture* texture = reinterpret_cast<SDL_Texture*>(info[0].As<Number>().Int64Value());
+  DetachLockedTexture(env, texture);
+  SDL_UnlockTexture(texture);
+  return env.Undefined();
 }
 
-Value Wrap_SDL_FlushAudioStream(const CallbackInfo& info) {
+Value Wrap_SDL_RenderTexture(const CallbackInfo& info) {
   Env env = info.Env();
-  if (info.Length() != 1 || !info[0].IsNumber()) {
-    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+  SDL_FRect srcRect, dstRect;
+  const SDL_FRect* srcPtr;
+  const SDL_FRect* dstPtr;
+  if (info.Length() != 4 || !info[0].IsNumber() || !info[1].IsNumber() ||
+      !GetOptionalFRect(info[2], &srcRect, &srcPtr) || !GetOptionalFRect(info[3], &dstRect, &dstPtr)) {
+    TypeError::New(env, "Expected renderer, texture, src rect or null, dst rect or null").ThrowAsJavaScriptException();
     return env.Undefined();
   }
 
-  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
-  bool result = SDL_FlushAudioStream(stream);
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  SDL_Texture* texture = reinterpret_cast<SDL_Texture*>(info[1].As<Number>().Int64Value());
+  bool result = SDL_RenderTexture(renderer, texture, srcPtr, dstPtr);
+  return Boolean::New(env, result);
+}
+
+// Render targets and pixel readback
+Value Wrap_SDL_SetRenderTarget(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsNumber() || !(info[1].IsNumber() || info[1].IsNull())) {
+    TypeError::New(env, "Expected renderer and texture or null").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  SDL_Texture* texture = info[1].IsNull() ? nullptr : reinterpret_cast<SDL_Texture*>(info[1].As<Number>().Int64Value());
+  bool result = SDL_SetRenderTarget(renderer, texture);
+  return Boolean::New(env, result);
+}
+
+static Object MakePixelsResult(Env env, int w, int h, int pitch, SDL_PixelFormat format) {
+  Object returnObj = Object::New(env);
+  returnObj.Set("w", Number::New(env, w));
+  returnObj.Set("h", Number::New(env, h));
+  returnObj.Set("pitch", Number::New(env, pitch));
+  returnObj.Set("format", Number::New(env, format));
+  return returnObj;
+}
+
+// Copies the current target into dstView, converting to format (default: the
+// renderer's native format) with the given pitch (default: tightly packed).
+Value Wrap_SDL_RenderReadPixels(const CallbackInfo& info) {
+  Env env = info.Env();
+  SDL_Rect rect;
+  const SDL_Rect* rectPtr;
+  void* dst = nullptr;
+  size_t length = 0;
+  if (info.Length() < 3 || info.Length() > 5 || !info[0].IsNumber() || !GetOptionalRect(info[1], &rect, &rectPtr) ||
+      !GetBufferData(info[2], &dst, &length) || (info.Length() > 3 && !info[3].IsNumber()) ||
+      (info.Length() > 4 && !info[4].IsNumber())) {
+    TypeError::New(env, "Expected renderer, rect or null, destination buffer, optional format and pitch").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  SDL_Surface* surface = SDL_RenderReadPixels(renderer, rectPtr);
+  if (!surface) {
+    return env.Null();
+  }
+
+  SDL_PixelFormat format = info.Length() > 3 ? static_cast<SDL_PixelFormat>(info[3].As<Number>().Uint32Value()) : surface->format;
+  int w = surface->w;
+  int h = surface->h;
+  size_t rowBytes = GetPackedRowBytes(format, w);
+  if (rowBytes == 0 || rowBytes > SDL_MAX_SINT32) {
+    SDL_DestroySurface(surface);
+    RangeError::New(env, "Readback format must be a packed pixel format").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  int pitch = info.Length() > 4 ? info[4].As<Number>().Int32Value() : static_cast<int>(rowBytes);
+  if (!HasPixelRows(rowBytes, h, pitch, length)) {
+    SDL_DestroySurface(surface);
+    RangeError::New(env, "Pitch is shorter than a row or the destination buffer is too small").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  bool result = SDL_ConvertPixels(w, h, surface->format, surface->pixels, surface->pitch, format, dst, pitch);
+  SDL_DestroySurface(surface);
+  if (!result) {
+    return env.Null();
+  }
+  return MakePixelsResult(env, w, h, pitch, format);
+}
+
+// Captures still read back on the JS thread (the renderer isn't thread-safe),
+// but conversion and encoding run on the thread pool. At most two captures
+// per renderer are in flight; further requests resolve null and count as
+// dropped until one completes.
+static const int kMaxCapturesInFlight = 2;
+
+struct CaptureState {
+  Uint64 generation = 0;
+  int inFlight = 0;
+  Uint64 completed = 0;
+  Uint64 dropped = 0;
+};
+
+static std::unordered_map<SDL_Renderer*, CaptureState> g_captures;
+static Uint64 g_captureGeneration = 0;
+
+// A renderer created later at the same address gets a new generation, so
+// captures still finishing for the old one don't count against it.
+static CaptureState& GetCaptureState(SDL_Renderer* renderer) {
+  CaptureState& state = g_captures[renderer];
+  if (state.generation == 0) {
+    state.generation = ++g_captureGeneration;
+  }
+  return state;
+}
+
+static void ForgetRendererCaptures(SDL_Renderer* renderer) {
+  g_captures.erase(renderer);
+}
+
+class ReadPixelsWorker : public AsyncWorker {
+ public:
+  ReadPixelsWorker(Napi::Env env, SDL_Renderer* renderer, Uint64 generation, SDL_Surface* surface, SDL_PixelFormat format,
+                   bool encodeBMP)
+      : AsyncWorker(env, "sdl.readPixels"), deferred_(Promise::Deferred::New(env)), renderer_(renderer),
+        generation_(generation), surface_(surface), format_(format), encodeBMP_(encodeBMP) {}
+
+  ~ReadPixelsWorker() {
+    SDL_DestroySurface(surface_);
+    SDL_free(output_);
+  }
+
+  void SetDestination(Object view, void* data, size_t length) {
+    dstRef_ = Persistent(view);
+    dst_ = data;
+    dstLength_ = length;
+  }
+
+  Promise GetPromise() const { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    int w = surface_->w;
+    int h = surface_->h;
+
+    if (encodeBMP_) {
+      SDL_Surface* source = surface_;
+      if (format_ != surface_->format) {
+        source = SDL_ConvertSurface(surface_, format_);
+        if (!source) {
+          SetError(SDL_GetError());
+          return;
+        }
+      }
+      SDL_IOStream* io = SDL_IOFromDynamicMem();
+      bool saved = io && SDL_SaveBMP_IO(source, io, false);
+      if (source != surface_) {
+        SDL_DestroySurface(source);
+      }
+      if (!saved) {
+        SetError(SDL_GetError());
+        SDL_CloseIO(io);
+        return;
+      }
+      // Take ownership of the stream's memory instead of copying it out.
+      SDL_PropertiesID props = SDL_GetIOProperties(io);
+      outputLength_ = static_cast<size_t>(SDL_GetIOSize(io));
+      output_ = SDL_GetPointerProperty(props, SDL_PROP_IOSTREAM_DYNAMIC_MEMORY_POINTER, nullptr);
+      SDL_SetPointerProperty(props, SDL_PROP_IOSTREAM_DYNAMIC_MEMORY_POINTER, nullptr);
+      SDL_CloseIO(io);
+      return;
+    }
+
+    // Wrap_ReadPixelsAsync has checked the format is packed and the row fits an int.
+    size_t rowBytes = GetPackedRowBytes(format_, w);
+    pitch_ = static_cast<int>(rowBytes);
+    size_t needed = rowBytes * h;
+    void* dst = dst_;
+    if (!dst) {
+      output_ = SDL_malloc(SDL_max(needed, static_cast<size_t>(1)));
+      outputLength_ = needed;
+      dst = output_;
+    } else if (!HasPixelRows(rowBytes, h, pitch_, dstLength_)) {
+      SetError("Destination buffer is smaller than pitch * height");
+      return;
+    }
+    if (!dst || !SDL_ConvertPixels(w, h, surface_->format, surface_->pixels, surface_->pitch, format_, dst, pitch_)) {
+      SetError(SDL_GetError());
+    }
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    FinishCapture();
+
+    Object result = MakePixelsResult(env, surface_->w, surface_->h, pitch_, format_);
+    if (!dstRef_.IsEmpty()) {
+      result.Set("buffer", dstRef_.Value());
+    } else {
+      void* output = output_;
+      output_ = nullptr;
+      result.Set("buffer", NewSDLOwnedArrayBuffer(env, static_cast<Uint8*>(output), outputLength_));
+    }
+    deferred_.Resolve(result);
+  }
+
+  void OnError(const Error& e) override {
+    FinishCapture();
+    deferred_.Reject(e.Value());
+  }
+
+ private:
+  void FinishCapture() {
+    // The renderer may have been destroyed, and its state dropped, meanwhile.
+    auto it = g_captures.find(renderer_);
+    if (it != g_captures.end() && it->second.generation == generation_) {
+      it->second.inFlight--;
+      it->second.completed++;
+    }
+  }
+
+  Promise::Deferred deferred_;
+  SDL_Renderer* renderer_;
+  Uint64 generation_;
+  SDL_Surface* surface_;
+  SDL_PixelFormat format_;
+  bool encodeBMP_;
+  ObjectReference dstRef_;
+  void* dst_ = nullptr;
+  size_t dstLength_ = 0;
+  void* output_ = nullptr;
+  size_t outputLength_ = 0;
+  int pitch_ = 0;
+};
+
+// readPixelsAsync(renderer, rect | null, { format?, dst?, encode?: "bmp" })
+// resolves { buffer, w, h, pitch, format }. Passing alternating dst views
+// keeps steady-state capture allocation-free; dst and encode are exclusive.
+Value Wrap_ReadPixelsAsync(const CallbackInfo& info) {
+  Env env = info.Env();
+  SDL_Rect rect;
+  const SDL_Rect* rectPtr;
+  if (info.Length() < 2 || info.Length() > 3 || !info[0].IsNumber() || !GetOptionalRect(info[1], &rect, &rectPtr) ||
+      (info.Length() == 3 && !info[2].IsObject())) {
+    TypeError::New(env, "Expected renderer, rect or null, optional options object").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Object options = info.Length() == 3 ? info[2].As<Object>() : Object::New(env);
+  Value formatValue = options.Get("format");
+  Value dstValue = options.Get("dst");
+  Value encodeValue = options.Get("encode");
+  void* dst = nullptr;
+  size_t dstLength = 0;
+  bool hasDst = !dstValue.IsUndefined() && !dstValue.IsNull();
+  bool encodeBMP = encodeValue.IsString() && encodeValue.As<String>().Utf8Value() == "bmp";
+  if ((!formatValue.IsUndefined() && !formatValue.IsNumber()) || (hasDst && !GetBufferData(dstValue, &dst, &dstLength)) ||
+      (!encodeValue.IsUndefined() && !encodeBMP)) {
+    TypeError::New(env, "Expected options { format?: number, dst?: buffer, encode?: \"bmp\" }").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (hasDst && encodeBMP) {
+    // The encoded size isn't known up front, so BMPs always get a new buffer.
+    TypeError::New(env, "dst can't be combined with encode").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  Promise::Deferred deferred = Promise::Deferred::New(env);
+  CaptureState& state = GetCaptureState(renderer);
+  if (state.inFlight >= kMaxCapturesInFlight) {
+    state.dropped++;
+    deferred.Resolve(env.Null());
+    return deferred.Promise();
+  }
+
+  SDL_Surface* surface = SDL_RenderReadPixels(renderer, rectPtr);
+  if (!surface) {
+    deferred.Reject(Error::New(env, SDL_GetError()).Value());
+    return deferred.Promise();
+  }
+
+  SDL_PixelFormat format = formatValue.IsNumber() ? static_cast<SDL_PixelFormat>(formatValue.As<Number>().Uint32Value()) : surface->format;
+  size_t rowBytes = GetPackedRowBytes(format, surface->w);
+  if (rowBytes == 0 || rowBytes > SDL_MAX_SINT32) {
+    SDL_DestroySurface(surface);
+    RangeError::New(env, "Readback format must be a packed pixel format").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (hasDst && !HasPixelRows(rowBytes, surface->h, static_cast<int>(rowBytes), dstLength)) {
+    SDL_DestroySurface(surface);
+    RangeError::New(env, "Destination buffer is smaller than pitch * height").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  ReadPixelsWorker* worker = new ReadPixelsWorker(env, renderer, state.generation, surface, format, encodeBMP);
+  if (hasDst) {
+    worker->SetDestination(dstValue.As<Object>(), dst, dstLength);
+  }
+  state.inFlight++;
+  Promise promise = worker->GetPromise();
+  worker->Queue();
+  return promise;
+}
+
+Value Wrap_GetCaptureStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected renderer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  auto it = g_captures.find(renderer);
+  CaptureState state = it != g_captures.end() ? it->second : CaptureState();
+  Object stats = Object::New(env);
+  stats.Set("inFlight", Number::New(env, state.inFlight));
+  stats.Set("completed", Number::New(env, static_cast<double>(state.completed)));
+  stats.Set("dropped", Number::New(env, static_cast<double>(state.dropped)));
+  return stats;
+}
+
+// Surface Functions
+//
+// Surfaces created over a caller's buffer keep that buffer referenced
+// (AddonData::surfaceBuffers) until destroySurface. Blits, fills and
+// conversions go straight to SDL's blitters and are safe to call from any
+// thread, as long as the same surfaces aren't used by two threads at once.
+
+Value Wrap_SDL_CreateSurface(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber()) {
+    TypeError::New(env, "Expected width, height, pixel format").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  int w = info[0].As<Number>().Int32Value();
+  int h = info[1].As<Number>().Int32Value();
+  SDL_PixelFormat format = static_cast<SDL_PixelFormat>(info[2].As<Number>().Uint32Value());
+  SDL_Surface* surface = SDL_CreateSurface(w, h, format);
+  if (!surface) {
+    return env.Null();
+  }
+
+  return Number::New(env, reinterpret_cast<uintptr_t>(surface));
+}
+
+// createSurfaceFrom(width, height, format, buffer, pitch?) wraps the buffer's
+// memory without copying.
+Value Wrap_SDL_CreateSurfaceFrom(const CallbackInfo& info) {
+  Env env = info.Env();
+  void* pixels = nullptr;
+  size_t length = 0;
+  if (info.Length() < 4 || info.Length() > 5 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber() ||
+      !GetBufferData(info[3], &pixels, &length) || (info.Length() == 5 && !info[4].IsNumber())) {
+    TypeError::New(env, "Expected width, height, pixel format, pixel buffer and optional pitch").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  int w = info[0].As<Number>().Int32Value();
+  int h = info[1].As<Number>().Int32Value();
+  SDL_PixelFormat format = static_cast<SDL_PixelFormat>(info[2].As<Number>().Uint32Value());
+  int pitch = info.Length() == 5 ? info[4].As<Number>().Int32Value() : GetDefaultPitch(format, w);
+  if (!HasPixelImage(format, w, h, pitch, length)) {
+    RangeError::New(env, "Pixel buffer is smaller than the image at this format and pitch").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Surface* surface = SDL_CreateSurfaceFrom(w, h, format, pixels, pitch);
+  if (!surface) {
+    return env.Null();
+  }
+
+  GetAddonData(env)->surfaceBuffers[surface] = Persistent(info[3].As<Object>());
+  return Number::New(env, reinterpret_cast<uintptr_t>(surface));
+}
+
+Value Wrap_SDL_DestroySurface(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected surface pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Surface* surface = reinterpret_cast<SDL_Surface*>(info[0].As<Number>().Int64Value());
+  SDL_DestroySurface(surface);
+  GetAddonData(env)->surfaceBuffers.erase(surface);
+  return env.Undefined();
+}
+
+Value Wrap_GetSurfaceInfo(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected surface pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Surface* surface = reinterpret_cast<SDL_Surface*>(info[0].As<Number>().Int64Value());
+  return MakePixelsResult(env, surface->w, surface->h, surface->pitch, surface->format);
+}
+
+// Arguments shared by the sync and async blits, with rects stored by value so
+// a job can outlive the call.
+struct BlitArgs {
+  SDL_Surface* src;
+  SDL_Surface* dst;
+  SDL_Rect srcRect;
+  SDL_Rect dstRect;
+  bool hasSrcRect;
+  bool hasDstRect;
+  bool scaled;
+  SDL_ScaleMode scaleMode;
+};
+
+static bool GetBlitArgs(const CallbackInfo& info, bool scaled, BlitArgs* args) {
+  size_t count = scaled ? 5 : 4;
+  const SDL_Rect* srcRectPtr;
+  const SDL_Rect* dstRectPtr;
+  if (info.Length() != count || !info[0].IsNumber() || !GetOptionalRect(info[1], &args->srcRect, &srcRectPtr) ||
+      !info[2].IsNumber() || !GetOptionalRect(info[3], &args->dstRect, &dstRectPtr) || (scaled && !info[4].IsNumber())) {
+    TypeError::New(info.Env(), scaled ? "Expected src surface, src rect or null, dst surface, dst rect or null, scale mode"
+                                      : "Expected src surface, src rect or null, dst surface, dst rect or null")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+  args->src = reinterpret_cast<SDL_Surface*>(info[0].As<Number>().Int64Value());
+  args->dst = reinterpret_cast<SDL_Surface*>(info[2].As<Number>().Int64Value());
+  args->hasSrcRect = srcRectPtr != nullptr;
+  args->hasDstRect = dstRectPtr != nullptr;
+  args->scaled = scaled;
+  args->scaleMode = scaled ? static_cast<SDL_ScaleMode>(info[4].As<Number>().Int32Value()) : SDL_SCALEMODE_NEAREST;
+  return true;
+}
+
+static bool RunBlit(BlitArgs args) {
+  const SDL_Rect* srcRect = args.hasSrcRect ? &args.srcRect : nullptr;
+  SDL_Rect* dstRect = args.hasDstRect ? &args.dstRect : nullptr;
+  if (args.scaled) {
+    return SDL_BlitSurfaceScaled(args.src, srcRect, args.dst, dstRect, args.scaleMode);
+  }
+  return SDL_BlitSurface(args.src, srcRect, args.dst, dstRect);
+}
+
+Value Wrap_SDL_BlitSurface(const CallbackInfo& info) {
+  Env env = info.Env();
+  BlitArgs args;
+  if (!GetBlitArgs(info, false, &args)) {
+    return env.Undefined();
+  }
+  return Boolean::New(env, RunBlit(args));
+}
+
+Value Wrap_SDL_BlitSurfaceScaled(const CallbackInfo& info) {
+  Env env = info.Env();
+  BlitArgs args;
+  if (!GetBlitArgs(info, true, &args)) {
+    return env.Undefined();
+  }
+  return Boolean::New(env, RunBlit(args));
+}
+
+// fillSurfaceRects(surface, Int32Array of x, y, w, h or null, r, g, b, a)
+Value Wrap_SDL_FillSurfaceRects(const CallbackInfo& info) {
+  Env env = info.Env();
+  bool wholeSurface = info.Length() > 1 && info[1].IsNull();
+  if (info.Length() != 6 || !info[0].IsNumber() ||
+      (!wholeSurface && (!info[1].IsTypedArray() || info[1].As<TypedArray>().TypedArrayType() != napi_int32_array)) ||
+      !info[2].IsNumber() || !info[3].IsNumber() || !info[4].IsNumber() || !info[5].IsNumber()) {
+    TypeError::New(env, "Expected surface, Int32Array of rects or null, r, g, b, a").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Surface* surface = reinterpret_cast<SDL_Surface*>(info[0].As<Number>().Int64Value());
+  Uint32 color = SDL_MapSurfaceRGBA(surface, info[2].As<Number>().Uint32Value(), info[3].As<Number>().Uint32Value(),
+                                    info[4].As<Number>().Uint32Value(), info[5].As<Number>().Uint32Value());
+  if (wholeSurface) {
+    return Boolean::New(env, SDL_FillSurfaceRect(surface, nullptr, color));
+  }
+
+  // SDL_Rect is four ints, so the Int32Array is passed through as-is.
+  Int32Array rects = info[1].As<Int32Array>();
+  int count = static_cast<int>(rects.ElementLength() / 4);
+  bool result = SDL_FillSurfaceRects(surface, reinterpret_cast<const SDL_Rect*>(rects.Data()), count, color);
+  return Boolean::New(env, result);
+}
+
+// Arguments shared by convertPixels and premultiplyAlpha:
+// (w, h, srcFormat, src, srcPitch, dstFormat, dst, dstPitch[, linear])
+struct PixelConversionArgs {
+  int w;
+  int h;
+  SDL_PixelFormat srcFormat;
+  const void* src;
+  int srcPitch;
+  SDL_PixelFormat dstFormat;
+  void* dst;
+  int dstPitch;
+  bool premultiply;
+  bool linear;
+};
+
+static bool GetPixelConversionArgs(const CallbackInfo& info, bool premultiply, PixelConversionArgs* args) {
+  Env env = info.Env();
+  void* src = nullptr;
+  void* dst = nullptr;
+  size_t srcLength = 0;
+  size_t dstLength = 0;
+  if (info.Length() < 8 || info.Length() > (premultiply ? 9u : 8u) || !info[0].IsNumber() || !info[1].IsNumber() ||
+      !info[2].IsNumber() || !GetBufferData(info[3], &src, &srcLength) || !info[4].IsNumber() || !info[5].IsNumber() ||
+      !GetBufferData(info[6], &dst, &dstLength) || !info[7].IsNumber() || (info.Length() == 9 && !info[8].IsBoolean())) {
+    TypeError::New(env, "Expected width, height, src format, src buffer, src pitch, dst format, dst buffer, dst pitch")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+
+  args->w = info[0].As<Number>().Int32Value();
+  args->h = info[1].As<Number>().Int32Value();
+  args->srcFormat = static_cast<SDL_PixelFormat>(info[2].As<Number>().Uint32Value());
+  args->src = src;
+  args->srcPitch = info[4].As<Number>().Int32Value();
+  args->dstFormat = static_cast<SDL_PixelFormat>(info[5].As<Number>().Uint32Value());
+  args->dst = dst;
+  args->dstPitch = info[7].As<Number>().Int32Value();
+  args->premultiply = premultiply;
+  args->linear = info.Length() == 9 && info[8].As<Boolean>().Value();
+  if (!HasPixelImage(args->srcFormat, args->w, args->h, args->srcPitch, srcLength) ||
+      !HasPixelImage(args->dstFormat, args->w, args->h, args->dstPitch, dstLength)) {
+    RangeError::New(env, "Pixel buffer is smaller than the image at this format and pitch").ThrowAsJavaScriptException();
+    return false;
+  }
+  return true;
+}
+
+static bool RunPixelConversion(const PixelConversionArgs& args) {
+  if (args.premultiply) {
+    return SDL_PremultiplyAlpha(args.w, args.h, args.srcFormat, args.src, args.srcPitch, args.dstFormat, args.dst,
+                                args.dstPitch, args.linear);
+  }
+  return SDL_ConvertPixels(args.w, args.h, args.srcFormat, args.src, args.srcPitch, args.dstFormat, args.dst,
+                           args.dstPitch);
+}
+
+Value Wrap_SDL_ConvertPixels(const CallbackInfo& info) {
+  Env env = info.Env();
+  PixelConversionArgs args;
+  if (!GetPixelConversionArgs(info, false, &args)) {
+    return env.Undefined();
+  }
+  return Boolean::New(env, RunPixelConversion(args));
+}
+
+Value Wrap_SDL_PremultiplyAlpha(const CallbackInfo& info) {
+  Env env = info.Env();
+  PixelConversionArgs args;
+  if (!GetPixelConversionArgs(info, true, &args)) {
+    return env.Undefined();
+  }
+  return Boolean::New(env, RunPixelConversion(args));
+}
+
+// Runs one blit or conversion on the thread pool. Surfaces are retained via
+// their refcount and JS buffers via references until the job completes, so
+// destroying a surface mid-flight is safe.
+class SurfaceWorker : public AsyncWorker {
+ public:
+  explicit SurfaceWorker(Napi::Env env)
+      : AsyncWorker(env, "sdl.surface"), deferred_(Promise::Deferred::New(env)) {}
+
+  ~SurfaceWorker() {
+    for (SDL_Surface* surface : surfaces_) {
+      SDL_DestroySurface(surface);
+    }
+  }
+
+  void SetBlit(const BlitArgs& args) {
+    blit_ = args;
+    isBlit_ = true;
+    RetainSurface(args.src);
+    RetainSurface(args.dst);
+  }
+
+  void SetConversion(const PixelConversionArgs& args, Object src, Object dst) {
+    conversion_ = args;
+    keepAlive_.push_back(Persistent(src));
+    keepAlive_.push_back(Persistent(dst));
+  }
+
+  Promise GetPromise() const { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    result_ = isBlit_ ? RunBlit(blit_) : RunPixelConversion(conversion_);
+  }
+
+  void OnOK() override {
+    deferred_.Resolve(Boolean::New(Env(), result_));
+  }
+
+  void OnError(const Error& e) override {
+    deferred_.Reject(e.Value());
+  }
+
+ private:
+  void RetainSurface(SDL_Surface* surface) {
+    surface->refcount++;
+    surfaces_.push_back(surface);
+    AddonData* data = GetAddonData(Env());
+    auto it = data->surfaceBuffers.find(surface);
+    if (it != data->surfaceBuffers.end()) {
+      keepAlive_.push_back(Persistent(it->second.Value()));
+    }
+  }
+
+  Promise::Deferred deferred_;
+  bool isBlit_ = false;
+  BlitArgs blit_ = {};
+  PixelConversionArgs conversion_ = {};
+  bool result_ = false;
+  std::vector<SDL_Surface*> surfaces_;
+  std::vector<ObjectReference> keepAlive_;
+};
+
+static Value QueueBlit(const CallbackInfo& info, bool scaled) {
+  Env env = info.Env();
+  BlitArgs args;
+  if (!GetBlitArgs(info, scaled, &args)) {
+    return env.Undefined();
+  }
+  SurfaceWorker* worker = new SurfaceWorker(env);
+  worker->SetBlit(args);
+  Promise promise = worker->GetPromise();
+  worker->Queue();
+  return promise;
+}
+
+static Value QueuePixelConversion(const CallbackInfo& info, bool premultiply) {
+  Env env = info.Env();
+  PixelConversionArgs args;
+  if (!GetPixelConversionArgs(info, premultiply, &args)) {
+    return env.Undefined();
+  }
+  SurfaceWorker* worker = new SurfaceWorker(env);
+  worker->SetConversion(args, info[3].As<Object>(), info[6].As<Object>());
+  Promise promise = worker->GetPromise();
+  worker->Queue();
+  return promise;
+}
+
+Value Wrap_BlitSurfaceAsync(const CallbackInfo& info) {
+  return QueueBlit(info, false);
+}
+
+Value Wrap_BlitSurfaceScaledAsync(const CallbackInfo& info) {
+  return QueueBlit(info, true);
+}
+
+Value Wrap_ConvertPixelsAsync(const CallbackInfo& info) {
+  return QueuePixelConversion(info, false);
+}
+
+Value Wrap_PremultiplyAlphaAsync(const CallbackInfo& info) {
+  return QueuePixelConversion(info, true);
+}
+
+Value Wrap_SDL_CreateTextureFromSurface(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    TypeError::New(env, "Expected renderer and surface pointers").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  SDL_Surface* surface = reinterpret_cast<SDL_Surface*>(info[1].As<Number>().Int64Value());
+  SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+  if (!texture) {
+    return env.Null();
+  }
+
+  return Number::New(env, reinterpret_cast<uintptr_t>(texture));
+}
+
+// updateTextureFromSurface(texture, surface, rect?) uploads in place; the
+// surface must already be in the texture's pixel format.
+Value Wrap_UpdateTextureFromSurface(const CallbackInfo& info) {
+  Env env = info.Env();
+  SDL_Rect rect;
+  const SDL_Rect* rectPtr = nullptr;
+  if (info.Length() < 2 || info.Length() > 3 || !info[0].IsNumber() || !info[1].IsNumber() ||
+      (info.Length() == 3 && !GetOptionalRect(info[2], &rect, &rectPtr))) {
+    TypeError::New(env, "Expected texture, surface and optional rect").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Texture* texture = reinterpret_cast<SDL_Texture*>(info[0].As<Number>().Int64Value());
+  SDL_Surface* surface = reinterpret_cast<SDL_Surface*>(info[1].As<Number>().Int64Value());
+  if (surface->format != texture->format) {
+    RangeError::New(env, "Surface and texture pixel formats differ").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  int w = rectPtr ? rect.w : texture->w;
+  int h = rectPtr ? rect.h : texture->h;
+  if (surface->w < w || surface->h < h) {
+    RangeError::New(env, "Surface is smaller than the texture region").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  bool result = SDL_UpdateTexture(texture, rectPtr, surface->pixels, surface->pitch);
+  return Boolean::New(env, result);
+}
+
+// Geometry rendering
+//
+// Vertices are interleaved Float32 records of x, y, r, g, b, a, u, v with
+// colors in 0..1, which SDL_RenderGeometryRaw reads in place via strides.
+static const int kGeometryVertexFloats = 8;
+
+Value Wrap_SDL_RenderGeometry(const CallbackInfo& info) {
+  Env env = info.Env();
+  const float* vertices = nullptr;
+  size_t vertexFloats = 0;
+  bool hasIndices = info.Length() == 4 && !info[3].IsNull() && !info[3].IsUndefined();
+  if (info.Length() < 3 || info.Length() > 4 || !info[0].IsNumber() ||
+      !(info[1].IsNumber() || info[1].IsNull()) || !GetFloatData(info[2], &vertices, &vertexFloats) ||
+      (hasIndices && !info[3].IsTypedArray())) {
+    TypeError::New(env, "Expected renderer, texture or null, Float32Array vertices, optional index array").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  SDL_Texture* texture = info[1].IsNull() ? nullptr : reinterpret_cast<SDL_Texture*>(info[1].As<Number>().Int64Value());
+  int numVertices = static_cast<int>(vertexFloats / kGeometryVertexFloats);
+
+  const void* indices = nullptr;
+  int numIndices = 0;
+  int indexSize = 0;
+  if (hasIndices) {
+    TypedArray indexArray = info[3].As<TypedArray>();
+    switch (indexArray.TypedArrayType()) {
+      case napi_uint8_array: indexSize = 1; break;
+      case napi_uint16_array: indexSize = 2; break;
+      case napi_uint32_array: indexSize = 4; break;
+      default:
+        TypeError::New(env, "Expected Uint8Array, Uint16Array or Uint32Array indices").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    size_t indexBytes;
+    void* indexData;
+    GetBufferData(indexArray, &indexData, &indexBytes);
+    indices = indexData;
+    numIndices = static_cast<int>(indexArray.ElementLength());
+  }
+
+  const int stride = kGeometryVertexFloats * sizeof(float);
+  bool result = SDL_RenderGeometryRaw(renderer, texture,
+                                      vertices, stride,
+                                      reinterpret_cast<const SDL_FColor*>(vertices + 2), stride,
+                                      vertices + 6, stride,
+                                      numVertices, indices, numIndices, indexSize);
+  return Boolean::New(env, result);
+}
+
+// Sprite batching
+//
+// Sprites are Float64 records (the texture handle doesn't fit in a float):
+//   texture, srcX, srcY, srcW, srcH, dstX, dstY, dstW, dstH, angle (degrees),
+//   r, g, b, a (tint, 0..1)
+// A zero srcW or srcH samples the whole texture. Consecutive sprites sharing
+// a texture become one SDL_RenderGeometryRaw call.
+static const int kSpriteRecordDoubles = 14;
+
+struct SpriteBatch {
+  std::vector<float> vertices;
+  std::vector<int> indices;
+};
+
+static SpriteBatch g_spriteBatch;
+
+static bool FlushSpriteBatch(SDL_Renderer* renderer, SDL_Texture* texture, SpriteBatch* batch) {
+  if (batch->indices.empty()) {
+    return true;
+  }
+  const int stride = kGeometryVertexFloats * sizeof(float);
+  const float* vertices = batch->vertices.data();
+  bool result = SDL_RenderGeometryRaw(renderer, texture,
+                                      vertices, stride,
+                                      reinterpret_cast<const SDL_FColor*>(vertices + 2), stride,
+                                      vertices + 6, stride,
+                                      static_cast<int>(batch->vertices.size() / kGeometryVertexFloats),
+                                      batch->indices.data(), static_cast<int>(batch->indices.size()), sizeof(int));
+  batch->vertices.clear();
+  batch->indices.clear();
+  return result;
+}
+
+Value Wrap_RenderSprites(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 2 || info.Length() > 3 || !info[0].IsNumber() || !info[1].IsTypedArray() ||
+      info[1].As<TypedArray>().TypedArrayType() != napi_float64_array ||
+      (info.Length() == 3 && !info[2].IsNumber())) {
+    TypeError::New(env, "Expected renderer, Float64Array sprites, optional count").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  Float64Array sprites = info[1].As<Float64Array>();
+  size_t available = sprites.ElementLength() / kSpriteRecordDoubles;
+  size_t count = info.Length() == 3 ? info[2].As<Number>().Uint32Value() : available;
+  if (count > available) {
+    RangeError::New(env, "Sprite count exceeds the array length").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SpriteBatch* batch = &g_spriteBatch;
+  batch->vertices.clear();
+  batch->indices.clear();
+
+  const double* record = sprites.Data();
+  SDL_Texture* current = nullptr;
+  float texW = 1, texH = 1;
+  int drawCalls = 0;
+  bool ok = true;
+
+  for (size_t i = 0; i < count; i++, record += kSpriteRecordDoubles) {
+    // Records are caller-filled doubles; a texture handle that is NaN,
+    // negative or beyond 2^53 can't be a pointer, so that sprite is skipped.
+    if (!(record[0] >= 0 && record[0] < 9007199254740992.0)) {
+      continue;
+    }
+    SDL_Texture* texture = reinterpret_cast<SDL_Texture*>(static_cast<uintptr_t>(record[0]));
+    if (texture != current || i == 0) {
+      if (!batch->indices.empty()) {
+        ok &= FlushSpriteBatch(renderer, current, batch);
+        drawCalls++;
+      }
+      current = texture;
+      if (!texture || !SDL_GetTextureSize(texture, &texW, &texH)) {
+        texW = texH = 1;
+      }
+    }
+
+    float sx = static_cast<float>(record[1]), sy = static_cast<float>(record[2]);
+    float sw = static_cast<float>(record[3]), sh = static_cast<float>(record[4]);
+    if (sw == 0 || sh == 0) {
+      sx = sy = 0;
+      sw = texW;
+      sh = texH;
+    }
+    float u0 = sx / texW, v0 = sy / texH, u1 = (sx + sw) / texW, v1 = (sy + sh) / texH;
+
+    float dx = static_cast<float>(record[5]), dy = static_cast<float>(record[6]);
+    float dw = static_cast<float>(record[7]), dh = static_cast<float>(record[8]);
+    float cx = dx + dw * 0.5f, cy = dy + dh * 0.5f;
+    float radians = static_cast<float>(record[9] * (SDL_PI_D / 180.0));
+    float c = SDL_cosf(radians), s = SDL_sinf(radians);
+
+    const float corners[4][4] = {
+      { -dw * 0.5f, -dh * 0.5f, u0, v0 },
+      { dw * 0.5f, -dh * 0.5f, u1, v0 },
+      { dw * 0.5f, dh * 0.5f, u1, v1 },
+      { -dw * 0.5f, dh * 0.5f, u0, v1 },
+    };
+
+    int base = static_cast<int>(batch->vertices.size() / kGeometryVertexFloats);
+    for (const auto& corner : corners) {
+      float x = cx + corner[0] * c - corner[1] * s;
+      float y = cy + corner[0] * s + corner[1] * c;
+      batch->vertices.insert(batch->vertices.end(), {
+        x, y,
+        static_cast<float>(record[10]), static_cast<float>(record[11]),
+        static_cast<float>(record[12]), static_cast<float>(record[13]),
+        corner[2], corner[3]
+      });
+    }
+    batch->indices.insert(batch->indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+  }
+
+  if (!batch->indices.empty()) {
+    ok &= FlushSpriteBatch(renderer, current, batch);
+    drawCalls++;
+  }
+
+  return Number::New(env, ok ? drawCalls : -1);
+}
+
+// Debug text
+Value Wrap_SDL_RenderDebugText(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 4 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber() || !info[3].IsString()) {
+    TypeError::New(env, "Expected renderer, x, y, text").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  float x = info[1].As<Number>().FloatValue();
+  float y = info[2].As<Number>().FloatValue();
+  std::string text = info[3].As<String>().Utf8Value();
+  bool result = SDL_RenderDebugText(renderer, x, y, text.c_str());
+  return Boolean::New(env, result);
+}
+
+// Cached text layer
+//
+// Each distinct string is rasterized once with SDL_RenderDebugText into a
+// white-on-transparent atlas (a target texture packed in 8px rows). Colour and
+// scale are applied per label through vertex colours and the destination size,
+// so they don't split the cache, and every label of a renderCachedText call
+// goes out as one geometry batch. When the atlas fills up it is cleared and
+// refilled on demand; after SDL_EVENT_RENDER_TARGETS_RESET the atlas contents
+// are gone and clearTextCache must be called.
+//
+// Layout records are 7 floats: x, y, scale, r, g, b, a (colour 0..1).
+static const int kTextRecordFloats = 7;
+static const int kTextRowHeight = SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE;
+
+struct TextCache {
+  SDL_Renderer* renderer;
+  SDL_Texture* atlas;
+  int width;
+  int height;
+  std::vector<int> rowCursors;
+  std::unordered_map<std::string, SDL_FRect> entries;
+  SpriteBatch batch;
+  Uint64 usedPixels = 0;
+  Uint64 hits = 0;
+  Uint64 misses = 0;
+  Uint64 uncached = 0;
+  Uint64 flushes = 0;
+};
+
+static int CountCodepoints(const std::string& text) {
+  int count = 0;
+  for (unsigned char c : text) {
+    if ((c & 0xC0) != 0x80) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Runs fn with target as render target, restoring the caller's target, draw
+// colour and blend mode afterwards.
+template <typename Fn>
+static bool DrawToTexture(SDL_Renderer* renderer, SDL_Texture* target, Fn fn) {
+  SDL_Texture* previous = SDL_GetRenderTarget(renderer);
+  Uint8 r, g, b, a;
+  SDL_BlendMode blendMode;
+  SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+  SDL_GetRenderDrawBlendMode(renderer, &blendMode);
+
+  bool ok = SDL_SetRenderTarget(renderer, target) && SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+  if (ok) {
+    ok = fn(renderer);
+  }
+
+  SDL_SetRenderTarget(renderer, previous);
+  SDL_SetRenderDrawColor(renderer, r, g, b, a);
+  SDL_SetRenderDrawBlendMode(renderer, blendMode);
+  return ok;
+}
+
+static bool ClearTextCache(TextCache* cache) {
+  cache->entries.clear();
+  std::fill(cache->rowCursors.begin(), cache->rowCursors.end(), 0);
+  cache->usedPixels = 0;
+  cache->flushes++;
+  return DrawToTexture(cache->renderer, cache->atlas, [](SDL_Renderer* renderer) {
+    return SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0) && SDL_RenderClear(renderer);
+  });
+}
+
+// Finds room for a w-pixel run, returning false if the atlas is full.
+static bool AllocateTextRun(TextCache* cache, int w, SDL_FRect* rect) {
+  for (size_t row = 0; row < cache->rowCursors.size(); row++) {
+    int& cursor = cache->rowCursors[row];
+    if (cursor + w <= cache->width) {
+      *rect = { static_cast<float>(cursor), static_cast<float>(row * kTextRowHeight), static_cast<float>(w),
+                static_cast<float>(kTextRowHeight) };
+      cursor += w;
+      cache->usedPixels += static_cast<Uint64>(w) * kTextRowHeight;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Looks a text cache handle up in this env's registry, throwing for unknown
+// or destroyed handles.
+static TextCache* GetTextCache(Env env, const Value& value) {
+  TextCache* cache = reinterpret_cast<TextCache*>(value.As<Number>().Int64Value());
+  if (!GetAddonData(env)->textCaches.count(cache)) {
+    RangeError::New(env, "Unknown text cache").ThrowAsJavaScriptException();
+    return nullptr;
+  }
+  return cache;
+}
+
+Value Wrap_CreateTextCache(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 1 || info.Length() > 3 || !info[0].IsNumber() || (info.Length() > 1 && !info[1].IsNumber()) ||
+      (info.Length() > 2 && !info[2].IsNumber())) {
+    TypeError::New(env, "Expected renderer and optional atlas width and height").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  int width = info.Length() > 1 ? info[1].As<Number>().Int32Value() : 1024;
+  int height = info.Length() > 2 ? info[2].As<Number>().Int32Value() : 1024;
+  if (width < kTextRowHeight || height < kTextRowHeight) {
+    RangeError::New(env, "Atlas must be at least one glyph in each dimension").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Texture* atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+  if (!atlas) {
+    return env.Null();
+  }
+  SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+  SDL_SetTextureScaleMode(atlas, SDL_SCALEMODE_NEAREST);
+
+  TextCache* cache = new TextCache();
+  cache->renderer = renderer;
+  cache->atlas = atlas;
+  cache->width = width;
+  cache->height = height;
+  cache->rowCursors.assign(height / kTextRowHeight, 0);
+  if (!ClearTextCache(cache)) {
+    SDL_DestroyTexture(atlas);
+    delete cache;
+    return env.Null();
+  }
+  cache->flushes = 0;
+
+  GetAddonData(env)->textCaches[cache] = true;
+  return Number::New(env, reinterpret_cast<uintptr_t>(cache));
+}
+
+Value Wrap_DestroyTextCache(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected text cache").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // Only handles still registered may be freed, so a second destroy is a no-op.
+  TextCache* cache = reinterpret_cast<TextCache*>(info[0].As<Number>().Int64Value());
+  if (!GetAddonData(env)->textCaches.erase(cache)) {
+    return Boolean::New(env, false);
+  }
+  SDL_DestroyTexture(cache->atlas);
+  delete cache;
+  return Boolean::New(env, true);
+}
+
+Value Wrap_ClearTextCache(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected text cache").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  TextCache* cache = GetTextCache(env, info[0]);
+  if (!cache) {
+    return env.Undefined();
+  }
+  return Boolean::New(env, ClearTextCache(cache));
+}
+
+// renderCachedText(cache, text | text[], Float32Array layout, count?)
+Value Wrap_RenderCachedText(const CallbackInfo& info) {
+  Env env = info.Env();
+  const float* layout = nullptr;
+  size_t layoutFloats = 0;
+  if (info.Length() < 3 || info.Length() > 4 || !info[0].IsNumber() || !(info[1].IsString() || info[1].IsArray()) ||
+      !GetFloatData(info[2], &layout, &layoutFloats) || (info.Length() == 4 && !info[3].IsNumber())) {
+    TypeError::New(env, "Expected text cache, string or string array, Float32Array layout, optional count").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  TextCache* cache = GetTextCache(env, info[0]);
+  if (!cache) {
+    return env.Undefined();
+  }
+  Array texts = info[1].IsArray() ? info[1].As<Array>() : Array();
+  size_t available = SDL_min(info[1].IsArray() ? texts.Length() : 1, layoutFloats / kTextRecordFloats);
+  size_t count = info.Length() == 4 ? info[3].As<Number>().Uint32Value() : available;
+  if (count > available) {
+    RangeError::New(env, "Label count exceeds the texts or layout length").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SpriteBatch* batch = &cache->batch;
+  batch->vertices.clear();
+  batch->indices.clear();
+  float invW = 1.0f / cache->width;
+  float invH = 1.0f / cache->height;
+  bool ok = true;
+
+  const float* record = layout;
+  for (size_t i = 0; i < count; i++, record += kTextRecordFloats) {
+    std::string text = info[1].IsArray() ? texts.Get(i).ToString().Utf8Value() : info[1].As<String>().Utf8Value();
+    if (text.empty()) {
+      continue;
+    }
+
+    SDL_FRect src;
+    auto it = cache->entries.find(text);
+    if (it != cache->entries.end()) {
+      src = it->second;
+      cache->hits++;
+    } else {
+      cache->misses++;
+      int w = CountCodepoints(text) * SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE;
+      if (w > cache->width) {
+        // Wider than the atlas: draw it directly, uncached. Labels batched so
+        // far go out first so the draw order matches the layout.
+        cache->uncached++;
+        ok &= FlushSpriteBatch(cache->renderer, cache->atlas, batch);
+        Uint8 r, g, b, a;
+        SDL_GetRenderDrawColor(cache->renderer, &r, &g, &b, &a);
+        SDL_SetRenderDrawColor(cache->renderer, ToColorComponent(record[3] * 255), ToColorComponent(record[4] * 255),
+                               ToColorComponent(record[5] * 255), ToColorComponent(record[6] * 255));
+        ok &= SDL_RenderDebugText(cache->renderer, record[0], record[1], text.c_str());
+        SDL_SetRenderDrawColor(cache->renderer, r, g, b, a);
+        continue;
+      }
+      if (!AllocateTextRun(cache, w, &src)) {
+        // Labels already batched still point at the old atlas contents.
+        ok &= FlushSpriteBatch(cache->renderer, cache->atlas, batch);
+        ok &= ClearTextCache(cache);
+        AllocateTextRun(cache, w, &src);
+      }
+      ok &= DrawToTexture(cache->renderer, cache->atlas, [&src, &text](SDL_Renderer* renderer) {
+        return SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255) &&
+               SDL_RenderDebugText(renderer, src.x, src.y, text.c_str());
+      });
+      cache->entries.emplace(std::move(text), src);
+    }
+
+    float x = record[0], y = record[1], scale = record[2];
+    float dw = src.w * scale, dh = src.h * scale;
+    float u0 = src.x * invW, v0 = src.y * invH, u1 = (src.x + src.w) * invW, v1 = (src.y + src.h) * invH;
+    int base = static_cast<int>(batch->vertices.size() / kGeometryVertexFloats);
+    batch->vertices.insert(batch->vertices.end(), {
+      x, y, record[3], record[4], record[5], record[6], u0, v0,
+      x + dw, y, record[3], record[4], record[5], record[6], u1, v0,
+      x + dw, y + dh, record[3], record[4], record[5], record[6], u1, v1,
+      x, y + dh, record[3], record[4], record[5], record[6], u0, v1,
+    });
+    batch->indices.insert(batch->indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+  }
+
+  ok &= FlushSpriteBatch(cache->renderer, cache->atlas, batch);
+  return Boolean::New(env, ok);
+}
+
+Value Wrap_GetTextCacheStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected text cache").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  TextCache* cache = GetTextCache(env, info[0]);
+  if (!cache) {
+    return env.Undefined();
+  }
+  Uint64 lookups = cache->hits + cache->misses;
+  Object stats = Object::New(env);
+  stats.Set("entries", Number::New(env, static_cast<double>(cache->entries.size())));
+  stats.Set("hits", Number::New(env, static_cast<double>(cache->hits)));
+  stats.Set("misses", Number::New(env, static_cast<double>(cache->misses)));
+  stats.Set("hitRate", Number::New(env, lookups ? static_cast<double>(cache->hits) / lookups : 0));
+  stats.Set("uncached", Number::New(env, static_cast<double>(cache->uncached)));
+  stats.Set("flushes", Number::New(env, static_cast<double>(cache->flushes)));
+  stats.Set("occupancy", Number::New(env, static_cast<double>(cache->usedPixels) / (static_cast<double>(cache->width) * cache->height)));
+  stats.Set("atlasWidth", Number::New(env, cache->width));
+  stats.Set("atlasHeight", Number::New(env, cache->height));
+  return stats;
+}
+
+// Retained display list
+//
+// Nodes (rects, lines, textured quads and debug text) live natively, keyed by
+// a JS-chosen id, and are composed into a cache texture the size of the list.
+// Setting or removing a node marks its old and new bounds dirty; renderDisplayList
+// redraws only the dirty rects, each under a clip rect (clear, then every node
+// that intersects it in z order), and then copies the whole cache to the current
+// target. A frame where nothing changed costs one texture copy. Texture nodes
+// hold raw texture handles: remove them before destroying the texture, and
+// call invalidateDisplayList after SDL_EVENT_RENDER_TARGETS_RESET.
+enum DisplayNodeType {
+  DISPLAY_NODE_RECT,
+  DISPLAY_NODE_FILL_RECT,
+  DISPLAY_NODE_LINE,
+  DISPLAY_NODE_TEXTURE,
+  DISPLAY_NODE_TEXT,
+};
+
+// Past this many pending rects they are collapsed into their union.
+static const size_t kMaxDirtyRects = 16;
+
+struct DisplayNode {
+  int type;
+  float z;
+  Uint64 seq;
+  float x, y, w, h, x2, y2;
+  Uint8 r, g, b, a;
+  SDL_Texture* texture;
+  SDL_FRect src;
+  bool hasSrc;
+  std::string text;
+  SDL_Rect bounds;
+};
+
+struct DisplayList {
+  SDL_Renderer* renderer;
+  SDL_Texture* cache;
+  int width;
+  int height;
+  Uint8 clear[4];
+  std::unordered_map<Uint32, DisplayNode> nodes;
+  std::vector<DisplayNode*> order;
+  bool orderDirty = false;
+  Uint64 nextSeq = 0;
+  std::vector<SDL_Rect> dirty;
+  Uint64 frames = 0;
+  Uint64 redraws = 0;
+  Uint64 nodesDrawn = 0;
+  Uint64 lastNodesDrawn = 0;
+  Uint64 lastDirtyPixels = 0;
+};
+
+static SDL_Rect GetDisplayNodeBounds(const DisplayNode& node) {
+  float x0 = node.x, y0 = node.y, x1, y1;
+  switch (node.type) {
+    case DISPLAY_NODE_LINE:
+      x0 = SDL_min(node.x, node.x2);
+      y0 = SDL_min(node.y, node.y2);
+      x1 = SDL_max(node.x, node.x2) + 1;
+      y1 = SDL_max(node.y, node.y2) + 1;
+      break;
+    case DISPLAY_NODE_TEXT:
+      x1 = node.x + CountCodepoints(node.text) * SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE;
+      y1 = node.y + SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE;
+      break;
+    default:
+      x1 = node.x + node.w;
+      y1 = node.y + node.h;
+      break;
+  }
+  // Node coordinates are arbitrary JS numbers; NaN and out-of-range values
+  // are clamped before they become ints.
+  int left = ToRectCoordinate(SDL_floorf(x0)), top = ToRectCoordinate(SDL_floorf(y0));
+  return { left, top, ToRectCoordinate(SDL_ceilf(x1)) - left, ToRectCoordinate(SDL_ceilf(y1)) - top };
+}
+
+// Reads a node description object:
+//   { type, x, y, w, h, x2, y2, r, g, b, a, z, texture, src: { x, y, w, h }, text }
+// Colour components are 0..255 and default to opaque white.
+static bool GetDisplayNode(const Value& value, DisplayNode* node) {
+  if (!value.IsObject()) {
+    return false;
+  }
+  Object props = value.As<Object>();
+  auto number = [&props](const char* key, float fallback) {
+    Value v = props.Get(key);
+    return v.IsNumber() ? v.As<Number>().FloatValue() : fallback;
+  };
+  auto component = [&number](const char* key) {
+    return static_cast<Uint8>(SDL_clamp(number(key, 255), 0.0f, 255.0f));
+  };
+
+  Value type = props.Get("type");
+  if (!type.IsNumber()) {
+    return false;
+  }
+  node->type = type.As<Number>().Int32Value();
+  if (node->type < DISPLAY_NODE_RECT || node->type > DISPLAY_NODE_TEXT) {
+    return false;
+  }
+  node->z = number("z", 0);
+  node->x = number("x", 0);
+  node->y = number("y", 0);
+  node->w = number("w", 0);
+  node->h = number("h", 0);
+  node->x2 = number("x2", 0);
+  node->y2 = number("y2", 0);
+  node->r = component("r");
+  node->g = component("g");
+  node->b = component("b");
+  node->a = component("a");
+
+  node->texture = nullptr;
+  node->hasSrc = false;
+  if (node->type == DISPLAY_NODE_TEXTURE) {
+    Value texture = props.Get("texture");
+    const SDL_FRect* srcPtr;
+    if (!texture.IsNumber() || !GetOptionalFRect(props.Get("src"), &node->src, &srcPtr)) {
+      return false;
+    }
+    node->texture = reinterpret_cast<SDL_Texture*>(texture.As<Number>().Int64Value());
+    node->hasSrc = srcPtr != nullptr;
+  }
+  node->text.clear();
+  if (node->type == DISPLAY_NODE_TEXT) {
+    Value text = props.Get("text");
+    if (!text.IsString()) {
+      return false;
+    }
+    node->text = text.As<String>().Utf8Value();
+  }
+
+  node->bounds = GetDisplayNodeBounds(*node);
+  return true;
+}
+
+static void AddDirtyRect(DisplayList* list, SDL_Rect rect) {
+  SDL_Rect whole = { 0, 0, list->width, list->height };
+  if (!SDL_GetRectIntersection(&rect, &whole, &rect)) {
+    return;
+  }
+  // Fold in every pending rect this one touches, so the list stays disjoint.
+  for (size_t i = 0; i < list->dirty.size();) {
+    if (SDL_HasRectIntersection(&rect, &list->dirty[i])) {
+      SDL_GetRectUnion(&rect, &list->dirty[i], &rect);
+      list->dirty[i] = list->dirty.back();
+      list->dirty.pop_back();
+      i = 0;
+    } else {
+      i++;
+    }
+  }
+  list->dirty.push_back(rect);
+  if (list->dirty.size() > kMaxDirtyRects) {
+    for (const SDL_Rect& other : list->dirty) {
+      SDL_GetRectUnion(&rect, &other, &rect);
+    }
+    list->dirty.assign(1, rect);
+  }
+}
+
+static void InvalidateDisplayList(DisplayList* list) {
+  list->dirty.assign(1, { 0, 0, list->width, list->height });
+}
+
+static bool DrawDisplayNode(SDL_Renderer* renderer, const DisplayNode& node) {
+  SDL_FRect rect = { node.x, node.y, node.w, node.h };
+  if (node.type == DISPLAY_NODE_TEXTURE) {
+    Uint8 r, g, b, a;
+    SDL_GetTextureColorMod(node.texture, &r, &g, &b);
+    SDL_GetTextureAlphaMod(node.texture, &a);
+    SDL_SetTextureColorMod(node.texture, node.r, node.g, node.b);
+    SDL_SetTextureAlphaMod(node.texture, node.a);
+    bool ok = SDL_RenderTexture(renderer, node.texture, node.hasSrc ? &node.src : nullptr, &rect);
+    SDL_SetTextureColorMod(node.texture, r, g, b);
+    SDL_SetTextureAlphaMod(node.texture, a);
+    return ok;
+  }
+
+  if (!SDL_SetRenderDrawColor(renderer, node.r, node.g, node.b, node.a)) {
+    return false;
+  }
+  switch (node.type) {
+    case DISPLAY_NODE_RECT:
+      return SDL_RenderRect(renderer, &rect);
+    case DISPLAY_NODE_FILL_RECT:
+      return SDL_RenderFillRect(renderer, &rect);
+    case DISPLAY_NODE_LINE:
+      return SDL_RenderLine(renderer, node.x, node.y, node.x2, node.y2);
+    default:
+      return SDL_RenderDebugText(renderer, node.x, node.y, node.text.c_str());
+  }
+}
+
+static bool RedrawDisplayList(DisplayList* list) {
+  if (list->orderDirty) {
+    list->order.clear();
+    for (auto& entry : list->nodes) {
+      list->order.push_back(&entry.second);
+    }
+    std::sort(list->order.begin(), list->order.end(), [](const DisplayNode* a, const DisplayNode* b) {
+      return a->z != b->z ? a->z < b->z : a->seq < b->seq;
+    });
+    list->orderDirty = false;
+  }
+
+  Uint64 drawn = 0, pixels = 0;
+  bool ok = DrawToTexture(list->renderer, list->cache, [list, &drawn, &pixels](SDL_Renderer* renderer) {
+    bool ok = true;
+    for (const SDL_Rect& rect : list->dirty) {
+      SDL_FRect area = { static_cast<float>(rect.x), static_cast<float>(rect.y), static_cast<float>(rect.w),
+                         static_cast<float>(rect.h) };
+      ok &= SDL_SetRenderClipRect(renderer, &rect);
+      ok &= SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+      ok &= SDL_SetRenderDrawColor(renderer, list->clear[0], list->clear[1], list->clear[2], list->clear[3]);
+      ok &= SDL_RenderFillRect(renderer, &area);
+      ok &= SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+      for (const DisplayNode* node : list->order) {
+        if (SDL_HasRectIntersection(&node->bounds, &rect)) {
+          ok &= DrawDisplayNode(renderer, *node);
+          drawn++;
+        }
+      }
+      pixels += static_cast<Uint64>(rect.w) * rect.h;
+    }
+    // The clip rect belongs to the cache's view and would outlive this call.
+    SDL_SetRenderClipRect(renderer, nullptr);
+    return ok;
+  });
+
+  list->dirty.clear();
+  list->redraws++;
+  list->nodesDrawn += drawn;
+  list->lastNodesDrawn = drawn;
+  list->lastDirtyPixels = pixels;
+  return ok;
+}
+
+// Looks a display list handle up in this env's registry, throwing for
+// unknown or destroyed handles.
+static DisplayList* GetDisplayList(Env env, const Value& value) {
+  DisplayList* list = reinterpret_cast<DisplayList*>(value.As<Number>().Int64Value());
+  if (!GetAddonData(env)->displayLists.count(list)) {
+    RangeError::New(env, "Unknown display list").ThrowAsJavaScriptException();
+    return nullptr;
+  }
+  return list;
+}
+
+// createDisplayList(renderer, width, height, clearColor?)
+Value Wrap_CreateDisplayList(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 3 || info.Length() > 4 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber() ||
+      (info.Length() == 4 && !info[3].IsObject())) {
+    TypeError::New(env, "Expected renderer, width, height and optional clear colour { r, g, b, a }").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  int width = info[1].As<Number>().Int32Value();
+  int height = info[2].As<Number>().Int32Value();
+  if (width <= 0 || height <= 0) {
+    RangeError::New(env, "Display list size must be positive").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  Uint8 clear[4] = { 0, 0, 0, 255 };
+  if (info.Length() == 4) {
+    Object color = info[3].As<Object>();
+    const char* keys[4] = { "r", "g", "b", "a" };
+    for (int i = 0; i < 4; i++) {
+      Value v = color.Get(keys[i]);
+      if (v.IsNumber()) {
+        clear[i] = static_cast<Uint8>(SDL_clamp(v.As<Number>().Int32Value(), 0, 255));
+      }
+    }
+  }
+
+  SDL_Texture* cache = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+  if (!cache) {
+    return env.Null();
+  }
+  SDL_SetTextureBlendMode(cache, clear[3] == 255 ? SDL_BLENDMODE_NONE : SDL_BLENDMODE_BLEND);
+
+  DisplayList* list = new DisplayList();
+  list->renderer = renderer;
+  list->cache = cache;
+  list->width = width;
+  list->height = height;
+  memcpy(list->clear, clear, sizeof(clear));
+  InvalidateDisplayList(list);
+  GetAddonData(env)->displayLists[list] = true;
+  return Number::New(env, reinterpret_cast<uintptr_t>(list));
+}
+
+Value Wrap_DestroyDisplayList(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected display list").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // Only handles still registered may be freed, so a second destroy is a no-op.
+  DisplayList* list = reinterpret_cast<DisplayList*>(info[0].As<Number>().Int64Value());
+  if (!GetAddonData(env)->displayLists.erase(list)) {
+    return Boolean::New(env, false);
+  }
+  SDL_DestroyTexture(list->cache);
+  delete list;
+  return Boolean::New(env, true);
+}
+
+// displayListSet(list, id, node) inserts or replaces the node with that id.
+Value Wrap_DisplayListSet(const CallbackInfo& info) {
+  Env env = info.Env();
+  DisplayNode node;
+  if (info.Length() != 3 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    TypeError::New(env, "Expected display list, node id, node").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (!GetDisplayNode(info[2], &node)) {
+    TypeError::New(env, "Expected node { type, x, y, ... } with texture for DISPLAY_NODE_TEXTURE and text for DISPLAY_NODE_TEXT")
+        .ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  DisplayList* list = GetDisplayList(env, info[0]);
+  if (!list) {
+    return env.Undefined();
+  }
+  Uint32 id = info[1].As<Number>().Uint32Value();
+  auto it = list->nodes.find(id);
+  if (it == list->nodes.end()) {
+    node.seq = list->nextSeq++;
+    list->nodes.emplace(id, std::move(node));
+    it = list->nodes.find(id);
+    list->orderDirty = true;
+  } else {
+    AddDirtyRect(list, it->second.bounds);
+    node.seq = it->second.seq;
+    list->orderDirty |= node.z != it->second.z;
+    it->second = std::move(node);
+  }
+  AddDirtyRect(list, it->second.bounds);
+  return env.Undefined();
+}
+
+Value Wrap_DisplayListRemove(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    TypeError::New(env, "Expected display list, node id").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  DisplayList* list = GetDisplayList(env, info[0]);
+  if (!list) {
+    return env.Undefined();
+  }
+  auto it = list->nodes.find(info[1].As<Number>().Uint32Value());
+  if (it == list->nodes.end()) {
+    return Boolean::New(env, false);
+  }
+  AddDirtyRect(list, it->second.bounds);
+  list->nodes.erase(it);
+  list->orderDirty = true;
+  return Boolean::New(env, true);
+}
+
+Value Wrap_ClearDisplayList(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected display list").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  DisplayList* list = GetDisplayList(env, info[0]);
+  if (!list) {
+    return env.Undefined();
+  }
+  list->nodes.clear();
+  list->order.clear();
+  list->orderDirty = false;
+  InvalidateDisplayList(list);
+  return env.Undefined();
+}
+
+Value Wrap_InvalidateDisplayList(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected display list").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  DisplayList* list = GetDisplayList(env, info[0]);
+  if (!list) {
+    return env.Undefined();
+  }
+  InvalidateDisplayList(list);
+  return env.Undefined();
+}
+
+// renderDisplayList(list, present?) redraws the dirty regions of the cache,
+// copies it over the current target and optionally presents.
+Value Wrap_RenderDisplayList(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 1 || info.Length() > 2 || !info[0].IsNumber() || (info.Length() == 2 && !info[1].IsBoolean())) {
+    TypeError::New(env, "Expected display list and optional present flag").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  DisplayList* list = GetDisplayList(env, info[0]);
+  if (!list) {
+    return env.Undefined();
+  }
+  bool ok = true;
+  if (!list->dirty.empty()) {
+    ok &= RedrawDisplayList(list);
+  } else {
+    list->lastNodesDrawn = 0;
+    list->lastDirtyPixels = 0;
+  }
+  ok &= SDL_RenderTexture(list->renderer, list->cache, nullptr, nullptr);
+  list->frames++;
+
+  if (info.Length() == 2 && info[1].As<Boolean>().Value()) {
+    ok &= SDL_RenderPresent(list->renderer);
+    RecordPresent(env);
+  }
+  return Boolean::New(env, ok);
+}
+
+Value Wrap_GetDisplayListStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected display list").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  DisplayList* list = GetDisplayList(env, info[0]);
+  if (!list) {
+    return env.Undefined();
+  }
+  Object stats = Object::New(env);
+  stats.Set("nodes", Number::New(env, static_cast<double>(list->nodes.size())));
+  stats.Set("pendingDirtyRects", Number::New(env, static_cast<double>(list->dirty.size())));
+  stats.Set("frames", Number::New(env, static_cast<double>(list->frames)));
+  stats.Set("redraws", Number::New(env, static_cast<double>(list->redraws)));
+  stats.Set("nodesDrawn", Number::New(env, static_cast<double>(list->nodesDrawn)));
+  stats.Set("lastNodesDrawn", Number::New(env, static_cast<double>(list->lastNodesDrawn)));
+  stats.Set("lastDirtyPixels", Number::New(env, static_cast<double>(list->lastDirtyPixels)));
+  stats.Set("lastDirtyFraction", Number::New(env, static_cast<double>(list->lastDirtyPixels) / (static_cast<double>(list->width) * list->height)));
+  return stats;
+}
+
+// Event filtering
+//
+// setEventFilter installs an SDL_SetEventFilter policy that runs as events are
+// queued. Types marked to drop are discarded and counted. Types marked to
+// coalesce (mouse motion, finger motion and window size/move events) are held
+// back, one per source, with later events merged in: positions and sizes take
+// the newest values while mouse xrel/yrel and finger dx/dy accumulate. Any
+// other event first releases everything held back, so clicks, key edges and
+// finger up/down keep their order relative to motion. Held events reach the
+// queue when the bindings below read it. Note that SDL discards events already
+// queued when a filter is installed or removed.
+enum EventPolicy : Uint8 {
+  EVENT_POLICY_PASS,
+  EVENT_POLICY_DROP,
+  EVENT_POLICY_COALESCE,
+};
+
+// Past this many held-back sources they are all released.
+static const size_t kMaxCoalescedEvents = 16;
+
+struct EventFilter {
+  std::mutex mutex;
+  std::vector<Uint8> policy;
+  std::vector<SDL_Event> pending;
+  Uint64 seen = 0;
+  Uint64 passed = 0;
+  Uint64 dropped = 0;
+  Uint64 merged = 0;
+  Uint64 released = 0;
+};
+
+static bool CanCoalesceEvent(Uint32 type) {
+  switch (type) {
+    case SDL_EVENT_MOUSE_MOTION:
+    case SDL_EVENT_FINGER_MOTION:
+    case SDL_EVENT_WINDOW_MOVED:
+    case SDL_EVENT_WINDOW_RESIZED:
+    case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool IsSameEventSource(const SDL_Event& a, const SDL_Event& b) {
+  if (a.type != b.type) {
+    return false;
+  }
+  switch (a.type) {
+    case SDL_EVENT_MOUSE_MOTION:
+      return a.motion.windowID == b.motion.windowID && a.motion.which == b.motion.which;
+    case SDL_EVENT_FINGER_MOTION:
+      return a.tfinger.touchID == b.tfinger.touchID && a.tfinger.fingerID == b.tfinger.fingerID;
+    default:
+      return a.window.windowID == b.window.windowID;
+  }
+}
+
+// Called with the filter mutex held.
+static void ReleaseCoalescedEvents(EventFilter* filter) {
+  if (filter->pending.empty()) {
+    return;
+  }
+  int count = static_cast<int>(filter->pending.size());
+  // ADDEVENT bypasses the filter, so this doesn't recurse.
+  int added = SDL_PeepEvents(filter->pending.data(), count, SDL_ADDEVENT, SDL_EVENT_FIRST, SDL_EVENT_LAST);
+  filter->released += SDL_max(added, 0);
+  filter->pending.clear();
+}
+
+static void CoalesceEvent(EventFilter* filter, const SDL_Event& event) {
+  for (SDL_Event& held : filter->pending) {
+    if (IsSameEventSource(held, event)) {
+      SDL_Event merged = event;
+      if (event.type == SDL_EVENT_MOUSE_MOTION) {
+        merged.motion.xrel += held.motion.xrel;
+        merged.motion.yrel += held.motion.yrel;
+      } else if (event.type == SDL_EVENT_FINGER_MOTION) {
+        merged.tfinger.dx += held.tfinger.dx;
+        merged.tfinger.dy += held.tfinger.dy;
+      }
+      held = merged;
+      filter->merged++;
+      return;
+    }
+  }
+  if (filter->pending.size() == kMaxCoalescedEvents) {
+    ReleaseCoalescedEvents(filter);
+  }
+  filter->pending.push_back(event);
+}
+
+static bool SDLCALL EventFilterCallback(void* userdata, SDL_Event* event) {
+  EventFilter* filter = static_cast<EventFilter*>(userdata);
+  std::lock_guard<std::mutex> lock(filter->mutex);
+  filter->seen++;
+  Uint8 policy = event->type < filter->policy.size() ? filter->policy[event->type] : static_cast<Uint8>(EVENT_POLICY_PASS);
+  if (policy == EVENT_POLICY_DROP) {
+    filter->dropped++;
+    return false;
+  }
+  if (policy == EVENT_POLICY_COALESCE) {
+    CoalesceEvent(filter, *event);
+    return false;
+  }
+  ReleaseCoalescedEvents(filter);
+  filter->passed++;
+  return true;
+}
+
+// Pumps the event loop and moves anything the filter is holding back into the
+// queue, after everything queued before it.
+static void PumpFilteredEvents(Env env) {
+  SDL_PumpEvents();
+  EventFilter* filter = GetAddonData(env)->eventFilter.get();
+  if (filter) {
+    std::lock_guard<std::mutex> lock(filter->mutex);
+    ReleaseCoalescedEvents(filter);
+  }
+}
+
+static bool GetEventTypeList(const Value& value, std::vector<Uint32>* types) {
+  if (value.IsUndefined()) {
+    return true;
+  }
+  if (!value.IsArray()) {
+    return false;
+  }
+  Array array = value.As<Array>();
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    Value type = array.Get(i);
+    if (!type.IsNumber()) {
+      return false;
+    }
+    types->push_back(type.As<Number>().Uint32Value());
+  }
+  return true;
+}
+
+// setEventFilter({ drop?: type[], coalesce?: type[] } | null)
+//
+// coalesce defaults to mouse motion, finger motion, window resize and pixel
+// size changes; pass [] to only drop. null removes the filter.
+Value Wrap_SetEventFilter(const CallbackInfo& info) {
+  Env env = info.Env();
+  std::vector<Uint32> drop;
+  std::vector<Uint32> coalesce = { SDL_EVENT_MOUSE_MOTION, SDL_EVENT_FINGER_MOTION, SDL_EVENT_WINDOW_RESIZED,
+                                   SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED };
+  if (info.Length() != 1 || !(info[0].IsNull() || info[0].IsObject())) {
+    TypeError::New(env, "Expected { drop, coalesce } event type arrays or null").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (info[0].IsObject()) {
+    Object options = info[0].As<Object>();
+    Value coalesceValue = options.Get("coalesce");
+    if (!coalesceValue.IsUndefined()) {
+      coalesce.clear();
+    }
+    if (!GetEventTypeList(options.Get("drop"), &drop) || !GetEventTypeList(coalesceValue, &coalesce)) {
+      TypeError::New(env, "Expected { drop, coalesce } event type arrays or null").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+    for (Uint32 type : drop) {
+      if (type > SDL_EVENT_LAST) {
+        RangeError::New(env, "Event type out of range").ThrowAsJavaScriptException();
+        return env.Undefined();
+      }
+    }
+    for (Uint32 type : coalesce) {
+      if (!CanCoalesceEvent(type)) {
+        RangeError::New(env, "Only motion and window move/size events can be coalesced").ThrowAsJavaScriptException();
+        return env.Undefined();
+      }
+    }
+  }
+
+  AddonData* data = GetAddonData(env);
+  if (info[0].IsNull()) {
+    if (data->eventFilter) {
+      SDL_SetEventFilter(nullptr, nullptr);
+      std::lock_guard<std::mutex> lock(data->eventFilter->mutex);
+      ReleaseCoalescedEvents(data->eventFilter.get());
+    }
+    data->eventFilter.reset();
+    return env.Undefined();
+  }
+
+  bool install = !data->eventFilter;
+  if (install) {
+    data->eventFilter.reset(new EventFilter());
+  }
+  EventFilter* filter = data->eventFilter.get();
+  {
+    std::lock_guard<std::mutex> lock(filter->mutex);
+    filter->policy.assign(SDL_EVENT_LAST + 1, EVENT_POLICY_PASS);
+    for (Uint32 type : coalesce) {
+      filter->policy[type] = EVENT_POLICY_COALESCE;
+    }
+    for (Uint32 type : drop) {
+      filter->policy[type] = EVENT_POLICY_DROP;
+    }
+    // Anything held back under the old policy goes out as it was.
+    ReleaseCoalescedEvents(filter);
+  }
+  if (install) {
+    SDL_SetEventFilter(EventFilterCallback, filter);
+  }
+  return env.Undefined();
+}
+
+Value Wrap_GetEventFilterStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  EventFilter* filter = GetAddonData(env)->eventFilter.get();
+  if (!filter) {
+    return env.Null();
+  }
+
+  std::lock_guard<std::mutex> lock(filter->mutex);
+  Object stats = Object::New(env);
+  stats.Set("seen", Number::New(env, static_cast<double>(filter->seen)));
+  stats.Set("passed", Number::New(env, static_cast<double>(filter->passed)));
+  stats.Set("dropped", Number::New(env, static_cast<double>(filter->dropped)));
+  stats.Set("merged", Number::New(env, static_cast<double>(filter->merged)));
+  stats.Set("released", Number::New(env, static_cast<double>(filter->released)));
+  stats.Set("pending", Number::New(env, static_cast<double>(filter->pending.size())));
+  return stats;
+}
+
+Value Wrap_SDL_SetEventEnabled(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsBoolean()) {
+    TypeError::New(env, "Expected event type, enabled").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_SetEventEnabled(info[0].As<Number>().Uint32Value(), info[1].As<Boolean>().Value());
+  return env.Undefined();
+}
+
+Value Wrap_SDL_EventEnabled(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected event type").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  return Boolean::New(env, SDL_EventEnabled(info[0].As<Number>().Uint32Value()));
+}
+
+Value Wrap_SDL_PollEvent(const CallbackInfo& info) {
+  Env env = info.Env();
+  SDL_Event event;
+  PumpFilteredEvents(env);
+  bool result = SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_EVENT_FIRST, SDL_EVENT_LAST) == 1;
+  if (result) {
+    Object jsEvent = Object::New(env);
+    jsEvent.Set("type", Number::New(env, event.type));
+    return jsEvent;
+  }
+  return env.Null();
+}
+
+Value Wrap_SDL_PushEvent(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 1 || info.Length() > 2 || !info[0].IsNumber() || (info.Length() == 2 && !info[1].IsNumber())) {
+    TypeError::New(env, "Expected event type and optional user code").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = info[0].As<Number>().Uint32Value();
+  event.common.timestamp = SDL_GetTicksNS();
+  if (event.type >= SDL_EVENT_USER && info.Length() == 2) {
+    event.user.code = info[1].As<Number>().Int32Value();
+  }
+
+  bool result = SDL_PushEvent(&event);
+  return Boolean::New(env, result);
+}
+
+// Fixed-stride event records written by pollEvents. All fields are native
+// endian; offsets are relative to the start of each EVENT_RECORD_SIZE record.
+//   0  u32 type        4  u32 windowID     8  f64 timestamp (ns)
+// key (KEY_DOWN/KEY_UP):
+//   16 u32 scancode    20 u32 key          24 u16 mod   26 u8 down  27 u8 repeat
+//   28 u32 keyboard id
+// mouse motion:
+//   16 f32 x  20 f32 y  24 f32 xrel  28 f32 yrel  32 u32 button state  36 u32 mouse id
+// mouse button:
+//   16 f32 x  20 f32 y  24 u8 button  25 u8 down  26 u8 clicks  28 u32 mouse id
+// mouse wheel:
+//   16 f32 x  20 f32 y  24 f32 mouse x  28 f32 mouse y  32 u32 direction  36 u32 mouse id
+// window events:
+//   16 i32 data1  20 i32 data2
+// audio device events:
+//   16 u32 device id  20 u8 recording
+// touch finger events:
+//   16 f32 x  20 f32 y  24 f32 dx  28 f32 dy  32 f32 pressure
+//   40 f64 touch id  48 f64 finger id
+struct EventRecord {
+  Uint32 type;
+  Uint32 windowID;
+  double timestamp;
+  union {
+    struct { Uint32 scancode, key; Uint16 mod; Uint8 down, repeat; Uint32 which; } key;
+    struct { float x, y, xrel, yrel; Uint32 state, which; } motion;
+    struct { float x, y; Uint8 button, down, clicks, padding; Uint32 which; } button;
+    struct { float x, y, mouseX, mouseY; Uint32 direction, which; } wheel;
+    struct { Sint32 data1, data2; } window;
+    struct { Uint32 which; Uint8 recording; } adevice;
+    struct { float x, y, dx, dy, pressure, padding; double touchID, fingerID; } tfinger;
+    Uint8 padding[48];
+  };
+};
+static_assert(sizeof(EventRecord) == 64, "EventRecord layout is part of the JS API");
+
+static void EncodeEventRecord(const SDL_Event& event, EventRecord* record) {
+  memset(record, 0, sizeof(*record));
+  record->type = event.type;
+  record->timestamp = static_cast<double>(event.common.timestamp);
+
+  switch (event.type) {
+    case SDL_EVENT_KEY_DOWN:
+    case SDL_EVENT_KEY_UP:
+      record->windowID = event.key.windowID;
+      record->key.scancode = event.key.scancode;
+      record->key.key = event.key.key;
+      record->key.mod = event.key.mod;
+      record->key.down = event.key.down;
+      record->key.repeat = event.key.repeat;
+      record->key.which = event.key.which;
+      break;
+    case SDL_EVENT_MOUSE_MOTION:
+      record->windowID = event.motion.windowID;
+      record->motion.x = event.motion.x;
+      record->motion.y = event.motion.y;
+      record->motion.xrel = event.motion.xrel;
+      record->motion.yrel = event.motion.yrel;
+      record->motion.state = event.motion.state;
+      record->motion.which = event.motion.which;
+      break;
+    case SDL_EVENT_MOUSE_BUTTON_DOWN:
+    case SDL_EVENT_MOUSE_BUTTON_UP:
+      record->windowID = event.button.windowID;
+      record->button.x = event.button.x;
+      record->button.y = event.button.y;
+      record->button.button = event.button.button;
+      record->button.down = event.button.down;
+      record->button.clicks = event.button.clicks;
+      record->button.which = event.button.which;
+      break;
+    case SDL_EVENT_MOUSE_WHEEL:
+      record->windowID = event.wheel.windowID;
+      record->wheel.x = event.wheel.x;
+      record->wheel.y = event.wheel.y;
+      record->wheel.mouseX = event.wheel.mouse_x;
+      record->wheel.mouseY = event.wheel.mouse_y;
+      record->wheel.direction = event.wheel.direction;
+      record->wheel.which = event.wheel.which;
+      break;
+    case SDL_EVENT_AUDIO_DEVICE_ADDED:
+    case SDL_EVENT_AUDIO_DEVICE_REMOVED:
+    case SDL_EVENT_AUDIO_DEVICE_FORMAT_CHANGED:
+      record->adevice.which = event.adevice.which;
+      record->adevice.recording = event.adevice.recording;
+      break;
+    case SDL_EVENT_FINGER_DOWN:
+    case SDL_EVENT_FINGER_UP:
+    case SDL_EVENT_FINGER_MOTION:
+    case SDL_EVENT_FINGER_CANCELED:
+      record->windowID = event.tfinger.windowID;
+      record->tfinger.x = event.tfinger.x;
+      record->tfinger.y = event.tfinger.y;
+      record->tfinger.dx = event.tfinger.dx;
+      record->tfinger.dy = event.tfinger.dy;
+      record->tfinger.pressure = event.tfinger.pressure;
+      record->tfinger.touchID = static_cast<double>(event.tfinger.touchID);
+      record->tfinger.fingerID = static_cast<double>(event.tfinger.fingerID);
+      break;
+    default:
+      if (event.type >= SDL_EVENT_WINDOW_FIRST && event.type <= SDL_EVENT_WINDOW_LAST) {
+        record->windowID = event.window.windowID;
+        record->window.data1 = event.window.data1;
+        record->window.data2 = event.window.data2;
+      }
+      break;
+  }
+}
+
+Value Wrap_SDL_PollEvents(const CallbackInfo& info) {
+  Env env = info.Env();
+  void* data = nullptr;
+  size_t length = 0;
+  if (info.Length() != 1 || !GetBufferData(info[0], &data, &length)) {
+    TypeError::New(env, "Expected ArrayBuffer, TypedArray or DataView").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  EventRecord* records = static_cast<EventRecord*>(data);
+  size_t capacity = length / sizeof(EventRecord);
+
+  PumpFilteredEvents(env);
+
+  SDL_Event events[64];
+  size_t count = 0;
+  while (count < capacity) {
+    int want = static_cast<int>(SDL_min(capacity - count, SDL_arraysize(events)));
+    int got = SDL_PeepEvents(events, want, SDL_GETEVENT, SDL_EVENT_FIRST, SDL_EVENT_LAST);
+    if (got <= 0) {
+      break;
+    }
+    for (int i = 0; i < got; i++) {
+      EventRecord record;
+      EncodeEventRecord(events[i], &record);
+      memcpy(records + count + i, &record, sizeof(record));
+    }
+    count += got;
+    if (got < want) {
+      break;
+    }
+  }
+
+  return Number::New(env, static_cast<double>(count));
+}
+
+// Asynchronous event waiting
+//
+// SDL only allows event pumping on the main thread, which is also the JS
+// thread, so waitEvent can't block in SDL_WaitEventTimeout. Instead a helper
+// thread sleeps until a pump is due and asks the JS thread to pump through a
+// ThreadSafeFunction. The pump interval backs off from minIntervalMs to
+// maxIntervalMs while no input arrives, an event watch wakes the helper as
+// soon as another thread pushes an event, and with no pending waiters the
+// helper blocks indefinitely and the process idles.
+struct EventWaiter {
+  Promise::Deferred deferred;
+  Uint64 deadlineNS;
+  std::shared_ptr<bool> iteratorClosed;
+};
+
+struct EventPump {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::thread thread;
+  ThreadSafeFunction tsfn;
+  bool started = false;
+  bool stopping = false;
+  bool wake = false;
+  bool pumpQueued = false;
+  bool referenced = false;
+  size_t waiting = 0;
+  Uint64 nextDeadlineNS = 0;
+  Uint32 minIntervalMs = 1;
+  Uint32 maxIntervalMs = 16;
+  Uint32 intervalMs = 1;
+
+  // Only touched on the JS thread
+  std::deque<EventWaiter> waiters;
+  Uint64 pumps = 0;
+  Uint64 idlePumps = 0;
+  Uint64 watchWakeups = 0;
+  Uint64 delivered = 0;
+  Uint64 latencyTotalNS = 0;
+  Uint64 latencyMaxNS = 0;
+};
+
+static EventPump* GetEventPump(Env env) {
+  AddonData* data = GetAddonData(env);
+  if (!data->eventPump) {
+    data->eventPump.reset(new EventPump());
+  }
+  return data->eventPump.get();
+}
+
+static const Uint64 kNoDeadline = ~static_cast<Uint64>(0);
+
+static bool SDLCALL EventPumpWatch(void* userdata, SDL_Event* event) {
+  // Events added while the JS thread pumps are picked up by that same pump.
+  if (!SDL_IsMainThread()) {
+    EventPump* pump = static_cast<EventPump*>(userdata);
+    std::lock_guard<std::mutex> lock(pump->mutex);
+    pump->wake = true;
+    pump->cv.notify_one();
+  }
+  return true;
+}
+
+static Object MakeEventObject(Env env, const SDL_Event& event) {
+  EventRecord record;
+  EncodeEventRecord(event, &record);
+  Object jsEvent = Object::New(env);
+  jsEvent.Set("type", Number::New(env, record.type));
+  jsEvent.Set("windowID", Number::New(env, record.windowID));
+  jsEvent.Set("timestamp", Number::New(env, record.timestamp));
+
+  // The same payload pollEvents writes into EVENT_RECORD_SIZE records.
+  switch (event.type) {
+    case SDL_EVENT_KEY_DOWN:
+    case SDL_EVENT_KEY_UP:
+      jsEvent.Set("scancode", Number::New(env, record.key.scancode));
+      jsEvent.Set("key", Number::New(env, record.key.key));
+      jsEvent.Set("mod", Number::New(env, record.key.mod));
+      jsEvent.Set("down", Boolean::New(env, record.key.down));
+      jsEvent.Set("repeat", Boolean::New(env, record.key.repeat));
+      jsEvent.Set("which", Number::New(env, record.key.which));
+      break;
+    case SDL_EVENT_MOUSE_MOTION:
+      jsEvent.Set("x", Number::New(env, record.motion.x));
+      jsEvent.Set("y", Number::New(env, record.motion.y));
+      jsEvent.Set("xrel", Number::New(env, record.motion.xrel));
+      jsEvent.Set("yrel", Number::New(env, record.motion.yrel));
+      jsEvent.Set("state", Number::New(env, record.motion.state));
+      jsEvent.Set("which", Number::New(env, record.motion.which));
+      break;
+    case SDL_EVENT_MOUSE_BUTTON_DOWN:
+    case SDL_EVENT_MOUSE_BUTTON_UP:
+      jsEvent.Set("x", Number::New(env, record.button.x));
+      jsEvent.Set("y", Number::New(env, record.button.y));
+      jsEvent.Set("button", Number::New(env, record.button.button));
+      jsEvent.Set("down", Boolean::New(env, record.button.down));
+      jsEvent.Set("clicks", Number::New(env, record.button.clicks));
+      jsEvent.Set("which", Number::New(env, record.button.which));
+      break;
+    case SDL_EVENT_MOUSE_WHEEL:
+      jsEvent.Set("x", Number::New(env, record.wheel.x));
+      jsEvent.Set("y", Number::New(env, record.wheel.y));
+      jsEvent.Set("mouseX", Number::New(env, record.wheel.mouseX));
+      jsEvent.Set("mouseY", Number::New(env, record.wheel.mouseY));
+      jsEvent.Set("direction", Number::New(env, record.wheel.direction));
+      jsEvent.Set("which", Number::New(env, record.wheel.which));
+      break;
+    case SDL_EVENT_AUDIO_DEVICE_ADDED:
+    case SDL_EVENT_AUDIO_DEVICE_REMOVED:
+    case SDL_EVENT_AUDIO_DEVICE_FORMAT_CHANGED:
+      jsEvent.Set("which", Number::New(env, record.adevice.which));
+      jsEvent.Set("recording", Boolean::New(env, record.adevice.recording));
+      break;
+    case SDL_EVENT_FINGER_DOWN:
+    case SDL_EVENT_FINGER_UP:
+    case SDL_EVENT_FINGER_MOTION:
+    case SDL_EVENT_FINGER_CANCELED:
+      jsEvent.Set("x", Number::New(env, record.tfinger.x));
+      jsEvent.Set("y", Number::New(env, record.tfinger.y));
+      jsEvent.Set("dx", Number::New(env, record.tfinger.dx));
+      jsEvent.Set("dy", Number::New(env, record.tfinger.dy));
+      jsEvent.Set("pressure", Number::New(env, record.tfinger.pressure));
+      jsEvent.Set("touchID", Number::New(env, record.tfinger.touchID));
+      jsEvent.Set("fingerID", Number::New(env, record.tfinger.fingerID));
+      break;
+    default:
+      if (event.type >= SDL_EVENT_WINDOW_FIRST && event.type <= SDL_EVENT_WINDOW_LAST) {
+        jsEvent.Set("data1", Number::New(env, record.window.data1));
+        jsEvent.Set("data2", Number::New(env, record.window.data2));
+      } else if (event.type >= SDL_EVENT_USER) {
+        jsEvent.Set("code", Number::New(env, event.user.code));
+      }
+      break;
+  }
+  return jsEvent;
+}
+
+static void ResolveEventWaiter(Env env, const EventWaiter& waiter, Value value, bool done) {
+  if (!waiter.iteratorClosed) {
+    waiter.deferred.Resolve(value);
+    return;
+  }
+  Object result = Object::New(env);
+  result.Set("value", value);
+  result.Set("done", Boolean::New(env, done));
+  waiter.deferred.Resolve(result);
+}
+
+static void UpdateEventPump(Env env, EventPump* pump) {
+  Uint64 nextDeadlineNS = kNoDeadline;
+  for (const EventWaiter& waiter : pump->waiters) {
+    nextDeadlineNS = SDL_min(nextDeadlineNS, waiter.deadlineNS);
+  }
+
+  // Keep the process alive only while someone is waiting for an event.
+  bool wantRef = !pump->waiters.empty();
+  if (wantRef != pump->referenced) {
+    if (wantRef) {
+      pump->tsfn.Ref(env);
+    } else {
+      pump->tsfn.Unref(env);
+    }
+    pump->referenced = wantRef;
+  }
+
+  std::lock_guard<std::mutex> lock(pump->mutex);
+  pump->waiting = pump->waiters.size();
+  pump->nextDeadlineNS = nextDeadlineNS;
+  pump->cv.notify_one();
+}
+
+static void PumpEventWaiters(Env env, EventPump* pump) {
+  {
+    std::lock_guard<std::mutex> lock(pump->mutex);
+    pump->pumpQueued = false;
+  }
+
+  PumpFilteredEvents(env);
+  pump->pumps++;
+
+  bool gotEvent = false;
+  while (!pump->waiters.empty()) {
+    EventWaiter& waiter = pump->waiters.front();
+    if (waiter.iteratorClosed && *waiter.iteratorClosed) {
+      ResolveEventWaiter(env, waiter, env.Undefined(), true);
+      pump->waiters.pop_front();
+      continue;
+    }
+
+    SDL_Event event;
+    if (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_EVENT_FIRST, SDL_EVENT_LAST) != 1) {
+      break;
+    }
+
+    Uint64 now = SDL_GetTicksNS();
+    Uint64 latency = now > event.common.timestamp ? now - event.common.timestamp : 0;
+    pump->latencyTotalNS += latency;
+    pump->latencyMaxNS = SDL_max(pump->latencyMaxNS, latency);
+    pump->delivered++;
+    gotEvent = true;
+
+    ResolveEventWaiter(env, waiter, MakeEventObject(env, event), false);
+    pump->waiters.pop_front();
+  }
+
+  Uint64 now = SDL_GetTicksNS();
+  for (auto it = pump->waiters.begin(); it != pump->waiters.end();) {
+    bool closed = it->iteratorClosed && *it->iteratorClosed;
+    if (closed || it->deadlineNS <= now) {
+      ResolveEventWaiter(env, *it, closed ? env.Undefined() : env.Null(), closed);
+      it = pump->waiters.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (!gotEvent) {
+    pump->idlePumps++;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pump->mutex);
+    pump->intervalMs = gotEvent ? pump->minIntervalMs : SDL_min(pump->intervalMs * 2, pump->maxIntervalMs);
+  }
+  UpdateEventPump(env, pump);
+}
+
+static void EventPumpThread(EventPump* pump) {
+  std::unique_lock<std::mutex> lock(pump->mutex);
+  while (!pump->stopping) {
+    if (pump->waiting == 0) {
+      pump->cv.wait(lock, [pump] { return pump->stopping || pump->waiting > 0; });
+      continue;
+    }
+    // Nothing to do until the queued pump has run; UpdateEventPump notifies.
+    if (pump->pumpQueued) {
+      pump->cv.wait(lock, [pump] { return pump->stopping || !pump->pumpQueued; });
+      continue;
+    }
+
+    // Kept in nanoseconds so a sub-millisecond deadline doesn't round to 0.
+    std::chrono::nanoseconds wait = std::chrono::milliseconds(pump->intervalMs);
+    if (pump->nextDeadlineNS != kNoDeadline) {
+      Uint64 now = SDL_GetTicksNS();
+      Uint64 untilDeadline = pump->nextDeadlineNS > now ? pump->nextDeadlineNS - now : 0;
+      wait = SDL_min(wait, std::chrono::nanoseconds(untilDeadline));
+    }
+    pump->cv.wait_for(lock, wait, [pump] { return pump->stopping || pump->wake; });
+    if (pump->stopping) {
+      break;
+    }
+    if (pump->wake) {
+      pump->wake = false;
+      pump->watchWakeups++;
+    }
+
+    if (pump->waiting > 0 && !pump->pumpQueued) {
+      pump->pumpQueued = true;
+      pump->tsfn.NonBlockingCall([pump](Env env, Function) { PumpEventWaiters(env, pump); });
+    }
+  }
+}
+
+static void StopEventPump(EventPump* pump) {
+  {
+    std::lock_guard<std::mutex> lock(pump->mutex);
+    pump->stopping = true;
+    pump->cv.notify_one();
+  }
+  pump->thread.join();
+  SDL_RemoveEventWatch(EventPumpWatch, pump);
+  pump->tsfn.Release();
+}
+
+static void StartEventPump(Env env, EventPump* pump) {
+  if (pump->started) {
+    return;
+  }
+  pump->tsfn = ThreadSafeFunction::New(env, Function::New(env, [](const CallbackInfo&) {}), "sdl.eventPump", 0, 1);
+  pump->tsfn.Unref(env);
+  pump->started = true;
+  SDL_AddEventWatch(EventPumpWatch, pump);
+  pump->thread = std::thread(EventPumpThread, pump);
+  env.AddCleanupHook(StopEventPump, pump);
+}
+
+static Value QueueEventWaiter(Env env, Uint64 deadlineNS, std::shared_ptr<bool> iteratorClosed) {
+  EventPump* pump = GetEventPump(env);
+  StartEventPump(env, pump);
+
+  Promise::Deferred deferred = Promise::Deferred::New(env);
+  pump->waiters.push_back({ deferred, deadlineNS, iteratorClosed });
+  {
+    std::lock_guard<std::mutex> lock(pump->mutex);
+    pump->intervalMs = pump->minIntervalMs;
+  }
+  PumpEventWaiters(env, pump);
+  return deferred.Promise();
+}
+
+Value Wrap_SDL_WaitEvent(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() > 1 || (info.Length() == 1 && !info[0].IsNumber())) {
+    TypeError::New(env, "Expected optional timeout in milliseconds").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // A negative or missing timeout waits forever.
+  double timeoutMs = info.Length() == 1 ? info[0].As<Number>().DoubleValue() : -1;
+  Uint64 deadlineNS = timeoutMs < 0 ? kNoDeadline : SDL_GetTicksNS() + static_cast<Uint64>(timeoutMs * SDL_NS_PER_MS);
+  return QueueEventWaiter(env, deadlineNS, nullptr);
+}
+
+Value Wrap_Events(const CallbackInfo& info) {
+  Env env = info.Env();
+  std::shared_ptr<bool> closed = std::make_shared<bool>(false);
+
+  Object iterator = Object::New(env);
+  iterator.Set("next", Function::New(env, [closed](const CallbackInfo& info) -> Value {
+    Env env = info.Env();
+    if (*closed) {
+      Promise::Deferred deferred = Promise::Deferred::New(env);
+      ResolveEventWaiter(env, { deferred, 0, closed }, env.Undefined(), true);
+      return deferred.Promise();
+    }
+    return QueueEventWaiter(env, kNoDeadline, closed);
+  }));
+  iterator.Set("return", Function::New(env, [closed](const CallbackInfo& info) -> Value {
+    Env env = info.Env();
+    *closed = true;
+    EventPump* pump = GetEventPump(env);
+    if (pump->started) {
+      PumpEventWaiters(env, pump);
+    }
+    Promise::Deferred deferred = Promise::Deferred::New(env);
+    ResolveEventWaiter(env, { deferred, 0, closed }, env.Undefined(), true);
+    return deferred.Promise();
+  }));
+  iterator.Set(Symbol::WellKnown(env, "asyncIterator"), Function::New(env, [](const CallbackInfo& info) -> Value {
+    return info.This();
+  }));
+  return iterator;
+}
+
+Value Wrap_SetEventPumpInterval(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    TypeError::New(env, "Expected min and max interval in milliseconds").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Uint32 minMs = SDL_max(info[0].As<Number>().Uint32Value(), 1u);
+  Uint32 maxMs = SDL_max(info[1].As<Number>().Uint32Value(), minMs);
+
+  EventPump* pump = GetEventPump(env);
+  std::lock_guard<std::mutex> lock(pump->mutex);
+  pump->minIntervalMs = minMs;
+  pump->maxIntervalMs = maxMs;
+  pump->intervalMs = minMs;
+  pump->cv.notify_one();
+  return env.Undefined();
+}
+
+Value Wrap_GetEventPumpStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  EventPump* pump = GetEventPump(env);
+
+  Uint64 watchWakeups;
+  Uint32 intervalMs;
+  {
+    std::lock_guard<std::mutex> lock(pump->mutex);
+    watchWakeups = pump->watchWakeups;
+    intervalMs = pump->intervalMs;
+  }
+
+  Object stats = Object::New(env);
+  stats.Set("pumps", Number::New(env, static_cast<double>(pump->pumps)));
+  stats.Set("idlePumps", Number::New(env, static_cast<double>(pump->idlePumps)));
+  stats.Set("watchWakeups", Number::New(env, static_cast<double>(watchWakeups)));
+  stats.Set("delivered", Number::New(env, static_cast<double>(pump->delivered)));
+  stats.Set("pending", Number::New(env, static_cast<double>(pump->waiters.size())));
+  stats.Set("intervalMs", Number::New(env, intervalMs));
+  stats.Set("avgLatencyMs", Number::New(env, pump->delivered ? pump->latencyTotalNS / 1e6 / pump->delivered : 0));
+  stats.Set("maxLatencyMs", Number::New(env, pump->latencyMaxNS / 1e6));
+  return stats;
+}
+
+// Frame loop
+//
+// A native thread sleeps until each frame deadline with SDL_DelayPrecise and
+// then asks the JS thread, through a ThreadSafeFunction, to run the frame
+// callback and present. The thread wakes early by the measured dispatch
+// latency so the callback starts on the deadline; frames that cannot start
+// because the previous one is still running, or whose deadline has already
+// passed, are counted as missed.
+//
+// The callback and SDL_RenderPresent both run on the JS thread, because the
+// renderer belongs to it. With vsync on, the present blocks that thread until
+// the vertical blank, so other JS work only runs in the gaps between frames.
+struct FrameLoop {
+  SDL_Renderer* renderer;
+  Uint64 periodNS;
+  std::thread thread;
+  ThreadSafeFunction tsfn;
+  std::atomic<bool> stopping{false};
+  std::atomic<bool> inFlight{false};
+  std::atomic<Uint64> leadNS{0};
+  std::atomic<Uint64> missed{0};
+  std::atomic<Uint64> scheduledNS{0};
+  Env::CleanupHook<void (*)(FrameLoop*), FrameLoop> cleanupHook;
+
+  // Only touched on the JS thread
+  Uint64 frames = 0;
+  Uint64 lastStartNS = 0;
+  Uint64 lastPresentNS = 0;
+  Uint64 presentTotalNS = 0;
+  Uint64 lateTotalNS = 0;
+  Uint64 lateMaxNS = 0;
+};
+
+static void RunFrame(Env env, Function callback, FrameLoop* loop) {
+  struct ClearInFlight {
+    FrameLoop* loop;
+    ~ClearInFlight() { loop->inFlight.store(false, std::memory_order_release); }
+  } clearInFlight{ loop };
+
+  if (loop->stopping.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  Uint64 start = SDL_GetTicksNS();
+  Uint64 scheduled = loop->scheduledNS.load(std::memory_order_acquire);
+  Uint64 late = start > scheduled ? start - scheduled : 0;
+  loop->lateTotalNS += late;
+  loop->lateMaxNS = SDL_max(loop->lateMaxNS, late);
+
+  // Move the wakeup lead towards the observed dispatch latency.
+  Uint64 lead = loop->leadNS.load(std::memory_order_relaxed);
+  Sint64 error = static_cast<Sint64>(start) - static_cast<Sint64>(scheduled);
+  Sint64 adjusted = static_cast<Sint64>(lead) + error / 8;
+  lead = static_cast<Uint64>(SDL_clamp(adjusted, static_cast<Sint64>(0), static_cast<Sint64>(loop->periodNS / 2)));
+  loop->leadNS.store(lead, std::memory_order_relaxed);
+
+  double deltaMs = loop->lastStartNS ? (start - loop->lastStartNS) / 1e6 : 0;
+  loop->lastStartNS = start;
+
+  Value result = callback.Call({
+    Number::New(env, static_cast<double>(loop->frames)),
+    Number::New(env, deltaMs),
+    Number::New(env, loop->lastPresentNS / 1e6),
+    Number::New(env, static_cast<double>(loop->missed.load(std::memory_order_relaxed))),
+  });
+  loop->frames++;
+
+  // Returning false from the callback skips the present for that frame.
+  if (env.IsExceptionPending() || loop->stopping.load(std::memory_order_acquire) ||
+      (result.IsBoolean() && !result.As<Boolean>().Value())) {
+    return;
+  }
+  Uint64 presentStart = SDL_GetTicksNS();
+  SDL_RenderPresent(loop->renderer);
+  RecordPresent(env);
+  loop->lastPresentNS = SDL_GetTicksNS() - presentStart;
+  loop->presentTotalNS += loop->lastPresentNS;
+}
+
+static void FrameLoopThread(FrameLoop* loop) {
+  Uint64 next = SDL_GetTicksNS() + loop->periodNS;
+  while (!loop->stopping.load(std::memory_order_acquire)) {
+    Uint64 lead = loop->leadNS.load(std::memory_order_relaxed);
+    Uint64 wake = next > lead ? next - lead : 0;
+    Uint64 now = SDL_GetTicksNS();
+    if (wake > now) {
+      SDL_DelayPrecise(wake - now);
+    }
+    if (loop->stopping.load(std::memory_order_acquire)) {
+      break;
+    }
+
+    if (loop->inFlight.exchange(true, std::memory_order_acq_rel)) {
+      loop->missed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      loop->scheduledNS.store(next, std::memory_order_release);
+      if (loop->tsfn.NonBlockingCall(loop, RunFrame) != napi_ok) {
+        loop->inFlight.store(false, std::memory_order_release);
+      }
+    }
+
+    // Skip whole periods we have already fallen behind on.
+    next += loop->periodNS;
+    now = SDL_GetTicksNS();
+    if (now > next) {
+      Uint64 behind = (now - next) / loop->periodNS + 1;
+      loop->missed.fetch_add(behind, std::memory_order_relaxed);
+      next += behind * loop->periodNS;
+    }
+  }
+}
+
+static void StopFrameLoop(FrameLoop* loop) {
+  loop->stopping.store(true, std::memory_order_release);
+  loop->thread.join();
+  loop->tsfn.Release();
+}
+
+// startFrameLoop(renderer, targetHz, callback, vsync?) calls
+// callback(frame, deltaMs, lastPresentMs, missedFrames) once per frame and
+// presents afterwards. Returns a handle for stopFrameLoop and getFrameLoopStats.
+// The present happens on the calling thread, so with vsync it waits there.
+Value Wrap_StartFrameLoop(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 3 || info.Length() > 4 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsFunction() ||
+      (info.Length() == 4 && !info[3].IsBoolean())) {
+    TypeError::New(env, "Expected renderer, target rate in Hz, callback and optional vsync flag").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_Renderer* renderer = reinterpret_cast<SDL_Renderer*>(info[0].As<Number>().Int64Value());
+  double targetHz = info[1].As<Number>().DoubleValue();
+  if (!(targetHz > 0 && targetHz <= 1000)) {
+    RangeError::New(env, "Target rate must be between 0 and 1000 Hz").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // With vsync the present itself lands on the vertical blank, so the thread
+  // only has to get the frame started ahead of it.
+  if (info.Length() == 4 && !SDL_SetRenderVSync(renderer, info[3].As<Boolean>().Value() ? 1 : 0)) {
+    return env.Null();
+  }
+
+  FrameLoop* loop = new FrameLoop();
+  loop->renderer = renderer;
+  loop->periodNS = static_cast<Uint64>(SDL_NS_PER_SECOND / targetHz);
+  loop->tsfn = ThreadSafeFunction::New(env, info[2].As<Function>(), "sdl.frameLoop", 0, 1,
+                                       [loop](Env) { delete loop; });
+  loop->thread = std::thread(FrameLoopThread, loop);
+  loop->cleanupHook = env.AddCleanupHook(StopFrameLoop, loop);
+  GetAddonData(env)->frameLoops[loop] = true;
+  return Number::New(env, reinterpret_cast<uintptr_t>(loop));
+}
+
+Value Wrap_StopFrameLoop(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected frame loop handle").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // The tsfn finalizer frees the loop once it is stopped, so only handles
+  // still registered here may be touched.
+  FrameLoop* loop = reinterpret_cast<FrameLoop*>(info[0].As<Number>().Int64Value());
+  if (!GetAddonData(env)->frameLoops.erase(loop)) {
+    return Boolean::New(env, false);
+  }
+  loop->cleanupHook.Remove(env);
+  StopFrameLoop(loop);
+  return Boolean::New(env, true);
+}
+
+Value Wrap_GetFrameLoopStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected frame loop handle").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  FrameLoop* loop = reinterpret_cast<FrameLoop*>(info[0].As<Number>().Int64Value());
+  if (!GetAddonData(env)->frameLoops.count(loop)) {
+    return env.Null();
+  }
+  Object stats = Object::New(env);
+  stats.Set("frames", Number::New(env, static_cast<double>(loop->frames)));
+  stats.Set("missed", Number::New(env, static_cast<double>(loop->missed.load())));
+  stats.Set("periodMs", Number::New(env, loop->periodNS / 1e6));
+  stats.Set("leadMs", Number::New(env, loop->leadNS.load() / 1e6));
+  stats.Set("avgLateMs", Number::New(env, loop->frames ? loop->lateTotalNS / 1e6 / loop->frames : 0));
+  stats.Set("maxLateMs", Number::New(env, loop->lateMaxNS / 1e6));
+  stats.Set("avgPresentMs", Number::New(env, loop->frames ? loop->presentTotalNS / 1e6 / loop->frames : 0));
+  return stats;
+}
+
+// Similar wrappers for other basics functions like SDL_InitSubSystem, SDL_QuitSubSystem, SDL_WasInit, SDL_IsMainThread, SDL_RunOnMainThread, SDL_SetAppMetadata, SDL_SetAppMetadataProperty, SDL_GetAppMetadataProperty
+
+Value Wrap_SDL_SetHintWithPriority(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 3 || !info[0].IsString() || !info[1].IsString() || !info[2].IsNumber()) {
+    TypeError::New(env, "Expected string, string, number").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  std::string name = info[0].As<String>().Utf8Value();
+  std::string value = info[1].As<String>().Utf8Value();
+  SDL_HintPriority priority = static_cast<SDL_HintPriority>(info[2].As<Number>().Int32Value());
+  return Boolean::New(env, SDL_SetHintWithPriority(name.c_str(), value.c_str(), priority));
+}
+
+// Similar wrappers for other hints, properties, error, log, assert, version functions based on the signatures.
+
+// Audio Device Functions
+Value Wrap_SDL_OpenAudioDevice(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    TypeError::New(env, "Expected audio spec object").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Object specObj = info[0].As<Object>();
+  SDL_AudioSpec spec;
+  spec.format = static_cast<SDL_AudioFormat>(specObj.Get("format").As<Number>().Uint32Value());
+  spec.channels = specObj.Get("channels").As<Number>().Int32Value();
+  spec.freq = specObj.Get("freq").As<Number>().Int32Value();
+
+  SDL_AudioDeviceID devid = info.Length() > 1 ? info[1].As<Number>().Uint32Value() : SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK;
+
+  SDL_AudioDeviceID device = SDL_OpenAudioDevice(devid, &spec);
+  if (device == 0) {
+    return env.Null();
+  }
+
+  return Number::New(env, device);
+}
+
+Value Wrap_SDL_CloseAudioDevice(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
+  SDL_CloseAudioDevice(devid);
+  return env.Undefined();
+}
+
+Value Wrap_SDL_GetAudioDeviceName(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
+  const char* name = SDL_GetAudioDeviceName(devid);
+  if (!name) {
+    return env.Null();
+  }
+  return String::New(env, name);
+}
+
+Value Wrap_SDL_PauseAudioDevice(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
+  bool result = SDL_PauseAudioDevice(devid);
+  return Boolean::New(env, result);
+}
+
+Value Wrap_SDL_ResumeAudioDevice(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
+  bool result = SDL_ResumeAudioDevice(devid);
+  return Boolean::New(env, result);
+}
+
+Value Wrap_SDL_AudioDevicePaused(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
+  bool result = SDL_AudioDevicePaused(devid);
+  return Boolean::New(env, result);
+}
+
+Value Wrap_SDL_SetAudioDeviceGain(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    TypeError::New(env, "Expected device ID and gain").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
+  float gain = info[1].As<Number>().FloatValue();
+  bool result = SDL_SetAudioDeviceGain(devid, gain);
+  return Boolean::New(env, result);
+}
+
+Value Wrap_SDL_GetAudioDeviceGain(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected device ID").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
+  float gain = SDL_GetAudioDeviceGain(devid);
+  return Number::New(env, gain);
+}
+
+// Upper bound for JS-sized audio rings: about three minutes of 48kHz stereo
+// float, far beyond any sensible buffering.
+static const Sint64 kMaxAudioRingBytes = 64 * 1024 * 1024;
+
+// Single-producer/single-consumer byte ring shared with SDL's audio thread.
+// Head and tail are monotonically increasing byte counts; each side only
+// writes its own counter, so no locks are needed.
+class SpscRing {
+ public:
+  explicit SpscRing(size_t capacity) : data_(new Uint8[capacity]), capacity_(capacity) {}
+
+  size_t Capacity() const { return capacity_; }
+  size_t Size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+
+  // Producer side
+  size_t Write(const void* src, size_t len) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    len = SDL_min(len, capacity_ - (head - tail));
+    size_t pos = head % capacity_;
+    size_t first = SDL_min(len, capacity_ - pos);
+    memcpy(data_.get() + pos, src, first);
+    memcpy(data_.get(), static_cast<const Uint8*>(src) + first, len - first);
+    head_.store(head + len, std::memory_order_release);
+    return len;
+  }
+
+  // Consumer side; fn(ptr, len) is called with up to two contiguous spans.
+  template <typename Fn>
+  size_t Consume(size_t maxLen, Fn fn) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t len = SDL_min(maxLen, head - tail);
+    size_t pos = tail % capacity_;
+    size_t first = SDL_min(len, capacity_ - pos);
+    if (first > 0) {
+      fn(data_.get() + pos, first);
+    }
+    if (len > first) {
+      fn(data_.get(), len - first);
+    }
+    tail_.store(tail + len, std::memory_order_release);
+    return len;
+  }
+
+  size_t Read(void* dst, size_t maxLen) {
+    Uint8* out = static_cast<Uint8*>(dst);
+    return Consume(maxLen, [&out](const Uint8* src, size_t len) {
+      memcpy(out, src, len);
+      out += len;
+    });
+  }
+
+ private:
+  std::unique_ptr<Uint8[]> data_;
+  size_t capacity_;
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+};
+
+// Pull-mode playback: SDL's audio thread drains the ring from a get callback
+// and JS is told through a ThreadSafeFunction when it drops below lowWater.
+struct AudioStreamPull {
+  SDL_AudioStream* stream;
+  SpscRing ring;
+  int frameSize;
+  std::atomic<size_t> lowWater;
+  std::atomic<bool> notifyPending{false};
+  std::atomic<Uint64> callbacks{0};
+  std::atomic<Uint64> underruns{0};
+  std::atomic<Uint64> underrunBytes{0};
+  Uint64 notifications = 0;
+  ThreadSafeFunction tsfn;
+
+  AudioStreamPull(SDL_AudioStream* stream, size_t capacity, int frameSize, size_t lowWater)
+      : stream(stream), ring(capacity), frameSize(frameSize), lowWater(lowWater) {}
+};
+
+static void ReleaseAudioStreamPull(Env env, SDL_AudioStream* stream) {
+  std::unordered_map<SDL_AudioStream*, AudioStreamPull*>& pulls = GetAddonData(env)->audioStreamPulls;
+  auto it = pulls.find(stream);
+  if (it == pulls.end()) {
+    return;
+  }
+  // Takes the stream lock, so the audio thread is out of the callback when
+  // this returns. The state itself is deleted by the tsfn finalizer once any
+  // queued low-water notifications have run.
+  SDL_SetAudioStreamGetCallback(stream, nullptr, nullptr);
+  it->second->tsfn.Release();
+  pulls.erase(it);
+}
+
+static void FinalizeAudioStreamPull(Env env, AudioStreamPull* pull) {
+  // On env teardown the tsfn is finalized without a release, with the
+  // callback still installed.
+  std::unordered_map<SDL_AudioStream*, AudioStreamPull*>& pulls = GetAddonData(env)->audioStreamPulls;
+  auto it = pulls.find(pull->stream);
+  if (it != pulls.end() && it->second == pull) {
+    SDL_SetAudioStreamGetCallback(pull->stream, nullptr, nullptr);
+    pulls.erase(it);
+  }
+  delete pull;
+}
+
+// Capture mode: a put callback on a recording stream moves converted samples
+// into the ring from SDL's audio thread, and JS receives whole blocks in
+// batches through a ThreadSafeFunction. The batch buffer and meters are
+// allocated once and reused for every delivery.
+struct AudioStreamCapture {
+  SDL_AudioStream* stream;
+  SpscRing ring;
+  size_t blockBytes;
+  size_t maxBlocks;
+  SDL_AudioFormat format;
+  std::unique_ptr<Uint8[]> scratch;
+  std::atomic<bool> notifyPending{false};
+  std::atomic<Uint64> callbacks{0};
+  std::atomic<Uint64> overruns{0};
+  std::atomic<Uint64> overrunBytes{0};
+  Uint64 batches = 0;
+  Uint64 blocks = 0;
+  ThreadSafeFunction tsfn;
+
+  // JS thread only
+  Reference<ArrayBuffer> batch;
+  Reference<Float32Array> meters;
+
+  AudioStreamCapture(SDL_AudioStream* stream, size_t blockBytes, size_t maxBlocks, SDL_AudioFormat format)
+      : stream(stream), ring(blockBytes * maxBlocks), blockBytes(blockBytes), maxBlocks(maxBlocks), format(format),
+        scratch(new Uint8[blockBytes]) {}
+};
+
+static void ReleaseAudioStreamCapture(Env env, SDL_AudioStream* stream) {
+  std::unordered_map<SDL_AudioStream*, AudioStreamCapture*>& captures = GetAddonData(env)->audioStreamCaptures;
+  auto it = captures.find(stream);
+  if (it == captures.end()) {
+    return;
+  }
+  SDL_SetAudioStreamPutCallback(stream, nullptr, nullptr);
+  it->second->tsfn.Release();
+  captures.erase(it);
+}
+
+static void FinalizeAudioStreamCapture(Env env, AudioStreamCapture* capture) {
+  std::unordered_map<SDL_AudioStream*, AudioStreamCapture*>& captures = GetAddonData(env)->audioStreamCaptures;
+  auto it = captures.find(capture->stream);
+  if (it != captures.end() && it->second == capture) {
+    SDL_SetAudioStreamPutCallback(capture->stream, nullptr, nullptr);
+    captures.erase(it);
+  }
+  delete capture;
+}
+
+// Playback telemetry and drift compensation: a get callback on a push-mode
+// stream observes every device pull on SDL's audio thread, counting shortfalls
+// and, when a target latency is set, steering SDL_SetAudioStreamFrequencyRatio
+// so the queue holds that much audio despite sender/device clock drift.
+struct AudioStreamMonitor {
+  SDL_AudioStream* stream;
+  double msPerByte;
+  std::atomic<float> targetMs;
+  std::atomic<float> maxAdjust;
+  std::atomic<float> overrunMs;
+  std::atomic<Uint64> callbacks{0};
+  std::atomic<Uint64> underruns{0};
+  std::atomic<Uint64> underrunBytes{0};
+  std::atomic<Uint64> overruns{0};
+  std::atomic<double> smoothedMs{-1.0};
+  std::atomic<double> minMs{-1.0};
+  std::atomic<double> maxMs{0.0};
+  std::atomic<double> ratio{1.0};
+
+  // Audio thread only
+  Uint64 lastTicksNS = 0;
+  double integral = 0.0;
+  bool overLimit = false;
+
+  AudioStreamMonitor(SDL_AudioStream* stream, double msPerByte, float targetMs, float maxAdjust, float overrunMs)
+      : stream(stream), msPerByte(msPerByte), targetMs(targetMs), maxAdjust(maxAdjust), overrunMs(overrunMs) {}
+};
+
+static void ReleaseAudioStreamMonitor(Env env, SDL_AudioStream* stream) {
+  std::unordered_map<SDL_AudioStream*, AudioStreamMonitor*>& monitors = GetAddonData(env)->audioStreamMonitors;
+  auto it = monitors.find(stream);
+  if (it == monitors.end()) {
+    return;
+  }
+  // As with pull mode, this waits out a running callback.
+  SDL_SetAudioStreamGetCallback(stream, nullptr, nullptr);
+  SDL_SetAudioStreamFrequencyRatio(stream, 1.0f);
+  delete it->second;
+  monitors.erase(it);
+}
+
+// Audio Stream Functions
+Value Wrap_SDL_CreateAudioStream(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsObject() || !info[1].IsObject()) {
+    TypeError::New(env, "Expected src and dst audio spec objects").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Object srcSpecObj = info[0].As<Object>();
+  Object dstSpecObj = info[1].As<Object>();
+
+  SDL_AudioSpec srcSpec, dstSpec;
+  srcSpec.format = static_cast<SDL_AudioFormat>(srcSpecObj.Get("format").As<Number>().Uint32Value());
+  srcSpec.channels = srcSpecObj.Get("channels").As<Number>().Int32Value();
+  srcSpec.freq = srcSpecObj.Get("freq").As<Number>().Int32Value();
+
+  dstSpec.format = static_cast<SDL_AudioFormat>(dstSpecObj.Get("format").As<Number>().Uint32Value());
+  dstSpec.channels = dstSpecObj.Get("channels").As<Number>().Int32Value();
+  dstSpec.freq = dstSpecObj.Get("freq").As<Number>().Int32Value();
+
+  SDL_AudioStream* stream = SDL_CreateAudioStream(&srcSpec, &dstSpec);
+  if (!stream) {
+    return env.Null();
+  }
+
+  return Number::New(env, reinterpret_cast<uintptr_t>(stream));
+}
+
+Value Wrap_SDL_DestroyAudioStream(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  ReleaseAudioStreamPull(env, stream);
+  ReleaseAudioStreamCapture(env, stream);
+  ReleaseAudioStreamMonitor(env, stream);
+  SDL_DestroyAudioStream(stream);
+  return env.Undefined();
+}
+
+Value Wrap_SDL_BindAudioStream(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    TypeError::New(env, "Expected device ID and stream pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[1].As<Number>().Int64Value());
+
+  bool result = SDL_BindAudioStream(devid, stream);
+  return Boolean::New(env, result);
+}
+
+Value Wrap_SDL_UnbindAudioStream(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  SDL_UnbindAudioStream(stream);
+  return env.Undefined();
+}
+
+Value Wrap_SDL_PutAudioStreamData(const CallbackInfo& info) {
+  Env env = info.Env();
+  void* data = nullptr;
+  size_t length = 0;
+  if (info.Length() < 2 || info.Length() > 4 || !info[0].IsNumber() || !GetBufferData(info[1], &data, &length)) {
+    TypeError::New(env, "Expected stream pointer, buffer, optional byte offset and length").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (!GetBufferRange(info, 2, &data, &length)) {
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  int len = static_cast<int>(SDL_min(length, static_cast<size_t>(SDL_MAX_SINT32)));
+  bool result = SDL_PutAudioStreamData(stream, data, len);
+  RecordAudioBytes(env, &Stats::audioBytesPut, result ? len : 0);
+  return Boolean::New(env, result);
+}
+
+// Reads into a caller-owned buffer and returns the byte count (or -1), so a
+// steady-state pump allocates nothing. The legacy (stream, size) form still
+// returns a freshly allocated { buffer, bytesRead }.
+Value Wrap_SDL_GetAudioStreamData(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() == 2 && info[0].IsNumber() && info[1].IsNumber()) {
+    SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+    int len = info[1].As<Number>().Int32Value();
+
+    ArrayBuffer buffer = ArrayBuffer::New(env, len);
+    int result = SDL_GetAudioStreamData(stream, buffer.Data(), len);
+    RecordAudioBytes(env, &Stats::audioBytesGot, result);
+
+    if (result < 0) {
+      return env.Null();
+    }
+
+    // Return both the buffer and actual bytes read
+    Object returnObj = Object::New(env);
+    returnObj.Set("buffer", buffer);
+    returnObj.Set("bytesRead", Number::New(env, result));
+    return returnObj;
+  }
+
+  void* data = nullptr;
+  size_t length = 0;
+  if (info.Length() < 2 || info.Length() > 4 || !info[0].IsNumber() || !GetBufferData(info[1], &data, &length)) {
+    TypeError::New(env, "Expected stream pointer and buffer size, or stream pointer, buffer, optional byte offset and length").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (!GetBufferRange(info, 2, &data, &length)) {
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  int result = SDL_GetAudioStreamData(stream, data, static_cast<int>(SDL_min(length, static_cast<size_t>(SDL_MAX_SINT32))));
+  RecordAudioBytes(env, &Stats::audioBytesGot, result);
+  return Number::New(env, result);
+}
+
+Value Wrap_SDL_GetAudioStreamAvailable(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  int available = SDL_GetAudioStreamAvailable(stream);
+  return Number::New(env, available);
+}
+
+Value Wrap_SDL_FlushAudioStream(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  bool result = SDL_FlushAudioStream(stream);
   return Boolean::New(env, result);
 }
 
@@ -464,84 +4137,1823 @@ Value Wrap_SDL_ClearAudioStream(const CallbackInfo& info) {
   }
 
   SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
-  bool result = SDL_ClearAudioStream(stream);
-  return Boolean::New(env, result);
+  bool result = SDL_ClearAudioStream(stream);
+  return Boolean::New(env, result);
+}
+
+static Object MakeWAVResult(Env env, const SDL_AudioSpec& spec, ArrayBuffer buffer, Uint32 length) {
+  Object returnObj = Object::New(env);
+  Object specObj = Object::New(env);
+  specObj.Set("format", Number::New(env, spec.format));
+  specObj.Set("channels", Number::New(env, spec.channels));
+  specObj.Set("freq", Number::New(env, spec.freq));
+
+  returnObj.Set("spec", specObj);
+  returnObj.Set("buffer", buffer);
+  returnObj.Set("length", Number::New(env, length));
+  return returnObj;
+}
+
+Value Wrap_SDL_LoadWAV(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsString()) {
+    TypeError::New(env, "Expected file path string").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  std::string path = info[0].As<String>().Utf8Value();
+  SDL_AudioSpec spec;
+  Uint8* audio_buf;
+  Uint32 audio_len;
+
+  bool result = SDL_LoadWAV(path.c_str(), &spec, &audio_buf, &audio_len);
+  if (!result) {
+    return env.Null();
+  }
+
+  return MakeWAVResult(env, spec, NewSDLOwnedArrayBuffer(env, audio_buf, audio_len), audio_len);
+}
+
+// Content-keyed cache of decoded WAV data, shared by every env. Entries are
+// keyed by a hash of the source bytes but keep those bytes too, and a hit
+// only counts when they compare equal, so a hash collision is just a miss.
+// Every caller gets its own copy of the PCM, so buffers can be modified
+// freely. Least recently used entries are evicted beyond limitBytes, which
+// counts both the source and decoded sizes.
+struct WAVCacheEntry {
+  SDL_AudioSpec spec;
+  std::vector<Uint8> source;
+  std::vector<Uint8> pcm;
+  std::list<Uint64>::iterator lru;
+};
+
+struct WAVCache {
+  std::mutex mutex;
+  std::unordered_map<Uint64, WAVCacheEntry> entries;
+  std::list<Uint64> lru;
+  size_t bytes = 0;
+  size_t limitBytes = 64 * 1024 * 1024;
+  Uint64 hits = 0;
+  Uint64 misses = 0;
+  Uint64 collisions = 0;
+  Uint64 evictions = 0;
+};
+
+static WAVCache g_wavCache;
+
+static Uint64 HashBytes(const void* data, size_t length) {
+  // FNV-1a, mixed with the length so truncated files don't collide.
+  const Uint8* bytes = static_cast<const Uint8*>(data);
+  Uint64 hash = 0xcbf29ce484222325ULL ^ length;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Called with the cache mutex held.
+static void EvictWAVCache(WAVCache* cache) {
+  while (cache->bytes > cache->limitBytes && !cache->lru.empty()) {
+    auto it = cache->entries.find(cache->lru.back());
+    cache->bytes -= it->second.source.size() + it->second.pcm.size();
+    cache->entries.erase(it);
+    cache->lru.pop_back();
+    cache->evictions++;
+  }
+}
+
+class LoadWAVWorker : public AsyncWorker {
+ public:
+  LoadWAVWorker(Napi::Env env, std::string path, bool useCache)
+      : AsyncWorker(env, "sdl.loadWAV"), deferred_(Promise::Deferred::New(env)), path_(std::move(path)),
+        useCache_(useCache) {}
+
+  LoadWAVWorker(Napi::Env env, Value source, const void* data, size_t length, bool useCache)
+      : AsyncWorker(env, "sdl.loadWAV"), deferred_(Promise::Deferred::New(env)), source_(Persistent(source.As<Object>())),
+        sourceData_(data), sourceLength_(length), useCache_(useCache) {}
+
+  ~LoadWAVWorker() {
+    SDL_free(fileData_);
+    SDL_free(audioBuf_);
+  }
+
+  Promise GetPromise() const { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    const void* data = sourceData_;
+    size_t length = sourceLength_;
+
+    if (!source_.IsEmpty() || useCache_) {
+      if (source_.IsEmpty()) {
+        fileData_ = SDL_LoadFile(path_.c_str(), &length);
+        if (!fileData_) {
+          SetError(SDL_GetError());
+          return;
+        }
+        data = fileData_;
+      }
+
+      Uint64 key = 0;
+      if (useCache_) {
+        key = HashBytes(data, length);
+        std::lock_guard<std::mutex> lock(g_wavCache.mutex);
+        auto it = g_wavCache.entries.find(key);
+        if (it != g_wavCache.entries.end()) {
+          const WAVCacheEntry& entry = it->second;
+          if (entry.source.size() == length && memcmp(entry.source.data(), data, length) == 0) {
+            g_wavCache.hits++;
+            g_wavCache.lru.splice(g_wavCache.lru.begin(), g_wavCache.lru, entry.lru);
+            spec_ = entry.spec;
+            audioLen_ = static_cast<Uint32>(entry.pcm.size());
+            audioBuf_ = static_cast<Uint8*>(SDL_malloc(SDL_max(audioLen_, 1u)));
+            if (!audioBuf_) {
+              SetError("Out of memory");
+              return;
+            }
+            memcpy(audioBuf_, entry.pcm.data(), audioLen_);
+            return;
+          }
+          g_wavCache.collisions++;
+        }
+        g_wavCache.misses++;
+      }
+
+      SDL_IOStream* io = SDL_IOFromConstMem(data, length);
+      if (!io || !SDL_LoadWAV_IO(io, true, &spec_, &audioBuf_, &audioLen_)) {
+        SetError(SDL_GetError());
+        return;
+      }
+      if (useCache_) {
+        AddToCache(key, data, length);
+      }
+      return;
+    }
+
+    if (!SDL_LoadWAV(path_.c_str(), &spec_, &audioBuf_, &audioLen_)) {
+      SetError(SDL_GetError());
+    }
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    Uint8* audioBuf = audioBuf_;
+    audioBuf_ = nullptr;
+    deferred_.Resolve(MakeWAVResult(env, spec_, NewSDLOwnedArrayBuffer(env, audioBuf, audioLen_), audioLen_));
+  }
+
+  void OnError(const Error& e) override {
+    deferred_.Reject(e.Value());
+  }
+
+ private:
+  void AddToCache(Uint64 key, const void* data, size_t length) {
+    size_t size = length + audioLen_;
+    std::lock_guard<std::mutex> lock(g_wavCache.mutex);
+    // Another load of the same bytes may have finished first (or, rarely,
+    // different bytes with the same hash); keep what is there.
+    if (size > g_wavCache.limitBytes || g_wavCache.entries.count(key)) {
+      return;
+    }
+    g_wavCache.lru.push_front(key);
+    WAVCacheEntry& entry = g_wavCache.entries[key];
+    entry.spec = spec_;
+    entry.source.assign(static_cast<const Uint8*>(data), static_cast<const Uint8*>(data) + length);
+    entry.pcm.assign(audioBuf_, audioBuf_ + audioLen_);
+    entry.lru = g_wavCache.lru.begin();
+    g_wavCache.bytes += size;
+    EvictWAVCache(&g_wavCache);
+  }
+
+  Promise::Deferred deferred_;
+  std::string path_;
+  ObjectReference source_;
+  const void* sourceData_ = nullptr;
+  size_t sourceLength_ = 0;
+  bool useCache_;
+  void* fileData_ = nullptr;
+  SDL_AudioSpec spec_ = {};
+  Uint8* audioBuf_ = nullptr;
+  Uint32 audioLen_ = 0;
+};
+
+Value Wrap_LoadWAVAsync(const CallbackInfo& info) {
+  Env env = info.Env();
+  void* data = nullptr;
+  size_t length = 0;
+  bool isPath = info.Length() >= 1 && info[0].IsString();
+  if (info.Length() < 1 || info.Length() > 2 || (!isPath && !GetBufferData(info[0], &data, &length)) ||
+      (info.Length() == 2 && !info[1].IsBoolean())) {
+    TypeError::New(env, "Expected file path or buffer and optional cache flag").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  bool useCache = info.Length() == 2 && info[1].As<Boolean>().Value();
+  LoadWAVWorker* worker = isPath ? new LoadWAVWorker(env, info[0].As<String>().Utf8Value(), useCache)
+                                 : new LoadWAVWorker(env, info[0], data, length, useCache);
+  Promise promise = worker->GetPromise();
+  worker->Queue();
+  return promise;
+}
+
+Value Wrap_ClearWAVCache(const CallbackInfo& info) {
+  Env env = info.Env();
+  std::lock_guard<std::mutex> lock(g_wavCache.mutex);
+  g_wavCache.entries.clear();
+  g_wavCache.lru.clear();
+  g_wavCache.bytes = 0;
+  return env.Undefined();
+}
+
+Value Wrap_SetWAVCacheLimit(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected cache limit in bytes").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Sint64 limit = info[0].As<Number>().Int64Value();
+  std::lock_guard<std::mutex> lock(g_wavCache.mutex);
+  g_wavCache.limitBytes = static_cast<size_t>(SDL_max(limit, static_cast<Sint64>(0)));
+  EvictWAVCache(&g_wavCache);
+  return env.Undefined();
+}
+
+Value Wrap_GetWAVCacheStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  std::lock_guard<std::mutex> lock(g_wavCache.mutex);
+
+  Object stats = Object::New(env);
+  stats.Set("entries", Number::New(env, static_cast<double>(g_wavCache.entries.size())));
+  stats.Set("bytes", Number::New(env, static_cast<double>(g_wavCache.bytes)));
+  stats.Set("limitBytes", Number::New(env, static_cast<double>(g_wavCache.limitBytes)));
+  stats.Set("hits", Number::New(env, static_cast<double>(g_wavCache.hits)));
+  stats.Set("misses", Number::New(env, static_cast<double>(g_wavCache.misses)));
+  stats.Set("collisions", Number::New(env, static_cast<double>(g_wavCache.collisions)));
+  stats.Set("evictions", Number::New(env, static_cast<double>(g_wavCache.evictions)));
+  return stats;
+}
+
+// Offline audio conversion
+static bool GetAudioSpec(const Value& value, SDL_AudioSpec* spec) {
+  if (!value.IsObject()) {
+    return false;
+  }
+  Object specObj = value.As<Object>();
+  Value format = specObj.Get("format");
+  Value channels = specObj.Get("channels");
+  Value freq = specObj.Get("freq");
+  if (!format.IsNumber() || !channels.IsNumber() || !freq.IsNumber()) {
+    return false;
+  }
+  spec->format = static_cast<SDL_AudioFormat>(format.As<Number>().Uint32Value());
+  spec->channels = channels.As<Number>().Int32Value();
+  spec->freq = freq.As<Number>().Int32Value();
+  return true;
+}
+
+// convertAudio(srcSpec, view, dstSpec, offset?, length?) returns the
+// converted samples in an SDL-owned ArrayBuffer, or null on failure.
+Value Wrap_ConvertAudio(const CallbackInfo& info) {
+  Env env = info.Env();
+  SDL_AudioSpec srcSpec, dstSpec;
+  void* data = nullptr;
+  size_t length = 0;
+  if (info.Length() < 3 || info.Length() > 5 || !GetAudioSpec(info[0], &srcSpec) ||
+      !GetBufferData(info[1], &data, &length) || !GetAudioSpec(info[2], &dstSpec)) {
+    TypeError::New(env, "Expected src spec, buffer, dst spec, optional offset and length").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (!GetBufferRange(info, 3, &data, &length)) {
+    return env.Undefined();
+  }
+  if (length > SDL_MAX_SINT32) {
+    RangeError::New(env, "Audio buffer too large").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Uint8* out = nullptr;
+  int outLen = 0;
+  if (!SDL_ConvertAudioSamples(&srcSpec, static_cast<const Uint8*>(data), static_cast<int>(length), &dstSpec, &out, &outLen)) {
+    return env.Null();
+  }
+
+  return NewSDLOwnedArrayBuffer(env, out, outLen);
+}
+
+// Shared state of one convertAudioBatch call. Its jobs are split across a
+// few chunk workers on the libuv pool that pull from a shared job index, so a
+// few thousand short clips don't each pay for a work item and no threads are
+// created per batch.
+struct ConvertAudioBatch {
+  struct Job {
+    SDL_AudioSpec srcSpec;
+    SDL_AudioSpec dstSpec;
+    const Uint8* data;
+    int length;
+    Uint8* out = nullptr;
+    int outLen = 0;
+  };
+
+  explicit ConvertAudioBatch(Napi::Env env) : deferred(Promise::Deferred::New(env)) {}
+
+  ~ConvertAudioBatch() {
+    for (Job& job : jobs) {
+      SDL_free(job.out);
+    }
+  }
+
+  Promise::Deferred deferred;
+  std::vector<Job> jobs;
+  std::vector<ObjectReference> sources;
+  std::atomic<size_t> next{0};
+  int pendingWorkers = 0;  // JS thread only
+};
+
+class ConvertAudioChunkWorker : public AsyncWorker {
+ public:
+  ConvertAudioChunkWorker(Napi::Env env, std::shared_ptr<ConvertAudioBatch> batch)
+      : AsyncWorker(env, "sdl.convertAudioBatch"), batch_(std::move(batch)) {}
+
+ protected:
+  void Execute() override {
+    std::vector<ConvertAudioBatch::Job>& jobs = batch_->jobs;
+    for (size_t i = batch_->next++; i < jobs.size(); i = batch_->next++) {
+      ConvertAudioBatch::Job& job = jobs[i];
+      if (!SDL_ConvertAudioSamples(&job.srcSpec, job.data, job.length, &job.dstSpec, &job.out, &job.outLen)) {
+        job.out = nullptr;
+      }
+    }
+  }
+
+  void OnOK() override {
+    // The last chunk to finish hands every result over to JS.
+    if (--batch_->pendingWorkers > 0) {
+      return;
+    }
+    Napi::Env env = Env();
+    Array results = Array::New(env, batch_->jobs.size());
+    for (size_t i = 0; i < batch_->jobs.size(); i++) {
+      ConvertAudioBatch::Job& job = batch_->jobs[i];
+      if (job.out) {
+        results.Set(i, NewSDLOwnedArrayBuffer(env, job.out, job.outLen));
+        job.out = nullptr;
+      } else {
+        results.Set(i, env.Null());
+      }
+    }
+    batch_->sources.clear();
+    batch_->deferred.Resolve(results);
+  }
+
+  void OnError(const Error& e) override {
+    if (--batch_->pendingWorkers == 0) {
+      batch_->deferred.Reject(e.Value());
+    }
+  }
+
+ private:
+  std::shared_ptr<ConvertAudioBatch> batch_;
+};
+
+// convertAudioBatch([{ src, data, dst }], threads?) resolves with one
+// ArrayBuffer per job, or null where that job failed to convert. threads is
+// clamped to the logical core count; the libuv pool size bounds it further.
+Value Wrap_ConvertAudioBatch(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 1 || info.Length() > 2 || !info[0].IsArray() || (info.Length() == 2 && !info[1].IsNumber())) {
+    TypeError::New(env, "Expected array of conversion jobs and optional thread count").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Array jobs = info[0].As<Array>();
+  std::shared_ptr<ConvertAudioBatch> batch = std::make_shared<ConvertAudioBatch>(env);
+  for (uint32_t i = 0; i < jobs.Length(); i++) {
+    Value jobValue = jobs.Get(i);
+    ConvertAudioBatch::Job job = {};
+    void* data = nullptr;
+    size_t length = 0;
+    if (!jobValue.IsObject() || !GetAudioSpec(jobValue.As<Object>().Get("src"), &job.srcSpec) ||
+        !GetBufferData(jobValue.As<Object>().Get("data"), &data, &length) ||
+        !GetAudioSpec(jobValue.As<Object>().Get("dst"), &job.dstSpec) || length > SDL_MAX_SINT32) {
+      TypeError::New(env, "Expected { src, data, dst } conversion job").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+    job.data = static_cast<const Uint8*>(data);
+    job.length = static_cast<int>(length);
+    batch->jobs.push_back(job);
+    batch->sources.push_back(Persistent(jobValue.As<Object>().Get("data").As<Object>()));
+  }
+
+  int cores = SDL_max(SDL_GetNumLogicalCPUCores(), 1);
+  int threads = info.Length() == 2 ? SDL_min(SDL_max(info[1].As<Number>().Int32Value(), 1), cores) : cores;
+  size_t workers = SDL_max(SDL_min(static_cast<size_t>(threads), batch->jobs.size()), static_cast<size_t>(1));
+  batch->pendingWorkers = static_cast<int>(workers);
+  for (size_t i = 0; i < workers; i++) {
+    (new ConvertAudioChunkWorker(env, batch))->Queue();
+  }
+  return batch->deferred.Promise();
+}
+
+// Pull-mode audio streams
+static void SDLCALL AudioStreamPullCallback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount) {
+  AudioStreamPull* pull = static_cast<AudioStreamPull*>(userdata);
+  pull->callbacks.fetch_add(1, std::memory_order_relaxed);
+
+  size_t wanted = static_cast<size_t>(additional_amount);
+  wanted -= wanted % pull->frameSize;
+  size_t got = pull->ring.Consume(wanted, [stream](const Uint8* data, size_t len) {
+    SDL_PutAudioStreamData(stream, data, static_cast<int>(len));
+  });
+  if (got < wanted) {
+    pull->underruns.fetch_add(1, std::memory_order_relaxed);
+    pull->underrunBytes.fetch_add(wanted - got, std::memory_order_relaxed);
+  }
+
+  if (pull->ring.Size() < pull->lowWater.load(std::memory_order_relaxed) &&
+      !pull->notifyPending.exchange(true, std::memory_order_acq_rel)) {
+    pull->tsfn.NonBlockingCall([pull](Env env, Function callback) {
+      pull->notifyPending.store(false, std::memory_order_release);
+      pull->notifications++;
+      callback.Call({ Number::New(env, static_cast<double>(pull->ring.Size())) });
+    });
+  }
+}
+
+Value Wrap_EnableAudioStreamPull(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 4 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber() ||
+      !info[3].IsFunction()) {
+    TypeError::New(env, "Expected stream pointer, ring capacity, low-water mark and callback").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  Sint64 requestedCapacity = info[1].As<Number>().Int64Value();
+  Sint64 requestedLowWater = info[2].As<Number>().Int64Value();
+  if (requestedCapacity <= 0 || requestedCapacity > kMaxAudioRingBytes) {
+    RangeError::New(env, "Ring capacity must be between 1 byte and 64 MiB").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (requestedLowWater < 0 || requestedLowWater > requestedCapacity) {
+    RangeError::New(env, "Low-water mark must be between 0 and the ring capacity").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  size_t capacity = static_cast<size_t>(requestedCapacity);
+  size_t lowWater = static_cast<size_t>(requestedLowWater);
+
+  SDL_AudioSpec srcSpec;
+  if (!SDL_GetAudioStreamFormat(stream, &srcSpec, nullptr)) {
+    return Boolean::New(env, false);
+  }
+  int frameSize = SDL_AUDIO_FRAMESIZE(srcSpec);
+  capacity -= capacity % frameSize;
+  if (capacity == 0) {
+    RangeError::New(env, "Ring capacity must hold at least one sample frame").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  lowWater = SDL_min(lowWater, capacity);
+
+  if (GetAddonData(env)->audioStreamMonitors.count(stream)) {
+    Error::New(env, "A stream monitor already owns this stream's get callback").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  ReleaseAudioStreamPull(env, stream);
+
+  AudioStreamPull* pull = new AudioStreamPull(stream, capacity, frameSize, lowWater);
+  pull->tsfn = ThreadSafeFunction::New(env, info[3].As<Function>(), "sdl.audioStreamPull", 0, 1,
+                                       [pull](Env env) { FinalizeAudioStreamPull(env, pull); });
+  pull->tsfn.Unref(env);
+
+  if (!SDL_SetAudioStreamGetCallback(stream, AudioStreamPullCallback, pull)) {
+    pull->tsfn.Release();
+    return Boolean::New(env, false);
+  }
+  GetAddonData(env)->audioStreamPulls[stream] = pull;
+  return Boolean::New(env, true);
+}
+
+Value Wrap_DisableAudioStreamPull(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  ReleaseAudioStreamPull(env, stream);
+  return env.Undefined();
+}
+
+Value Wrap_WriteAudioStreamPull(const CallbackInfo& info) {
+  Env env = info.Env();
+  void* data = nullptr;
+  size_t length = 0;
+  if (info.Length() < 2 || info.Length() > 4 || !info[0].IsNumber() || !GetBufferData(info[1], &data, &length)) {
+    TypeError::New(env, "Expected stream pointer, buffer, optional byte offset and length").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (!GetBufferRange(info, 2, &data, &length)) {
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  std::unordered_map<SDL_AudioStream*, AudioStreamPull*>& pulls = GetAddonData(env)->audioStreamPulls;
+  auto it = pulls.find(stream);
+  if (it == pulls.end()) {
+    Error::New(env, "Pull mode is not enabled on this stream").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  AudioStreamPull* pull = it->second;
+  length -= length % pull->frameSize;
+  size_t written = pull->ring.Write(data, length);
+  RecordAudioBytes(env, &Stats::audioBytesPut, static_cast<int>(written));
+  return Number::New(env, static_cast<double>(written));
+}
+
+Value Wrap_SetAudioStreamPullLowWater(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer and low-water mark").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  std::unordered_map<SDL_AudioStream*, AudioStreamPull*>& pulls = GetAddonData(env)->audioStreamPulls;
+  auto it = pulls.find(stream);
+  if (it == pulls.end()) {
+    return Boolean::New(env, false);
+  }
+  Sint64 lowWater = info[1].As<Number>().Int64Value();
+  if (lowWater < 0 || static_cast<size_t>(lowWater) > it->second->ring.Capacity()) {
+    RangeError::New(env, "Low-water mark must be between 0 and the ring capacity").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  it->second->lowWater.store(static_cast<size_t>(lowWater), std::memory_order_relaxed);
+  return Boolean::New(env, true);
+}
+
+Value Wrap_GetAudioStreamPullStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  std::unordered_map<SDL_AudioStream*, AudioStreamPull*>& pulls = GetAddonData(env)->audioStreamPulls;
+  auto it = pulls.find(stream);
+  if (it == pulls.end()) {
+    return env.Null();
+  }
+
+  AudioStreamPull* pull = it->second;
+  Object stats = Object::New(env);
+  stats.Set("capacity", Number::New(env, static_cast<double>(pull->ring.Capacity())));
+  stats.Set("lowWater", Number::New(env, static_cast<double>(pull->lowWater.load())));
+  stats.Set("buffered", Number::New(env, static_cast<double>(pull->ring.Size())));
+  stats.Set("callbacks", Number::New(env, static_cast<double>(pull->callbacks.load())));
+  stats.Set("underruns", Number::New(env, static_cast<double>(pull->underruns.load())));
+  stats.Set("underrunBytes", Number::New(env, static_cast<double>(pull->underrunBytes.load())));
+  stats.Set("notifications", Number::New(env, static_cast<double>(pull->notifications)));
+  return stats;
+}
+
+// Stream monitoring and adaptive latency
+//
+// The controller is a PI loop on the queued latency, smoothed over roughly
+// 20 callbacks. Its output is clamped to +/-maxAdjust (0.5% by default, well
+// under what is audible as pitch) and slewed so the ratio never jumps.
+static const double kMonitorSmoothing = 0.05;
+static const double kMonitorProportional = 0.01;
+static const double kMonitorIntegral = 0.002;
+static const double kMonitorMaxRatioStep = 0.0002;
+
+static void SDLCALL AudioStreamMonitorCallback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount) {
+  AudioStreamMonitor* monitor = static_cast<AudioStreamMonitor*>(userdata);
+  monitor->callbacks.fetch_add(1, std::memory_order_relaxed);
+  if (additional_amount > 0) {
+    monitor->underruns.fetch_add(1, std::memory_order_relaxed);
+    monitor->underrunBytes.fetch_add(additional_amount, std::memory_order_relaxed);
+  }
+
+  double latencyMs = SDL_max(SDL_GetAudioStreamQueued(stream), 0) * monitor->msPerByte;
+  double smoothedMs = monitor->smoothedMs.load(std::memory_order_relaxed);
+  smoothedMs = smoothedMs < 0 ? latencyMs : smoothedMs + kMonitorSmoothing * (latencyMs - smoothedMs);
+  monitor->smoothedMs.store(smoothedMs, std::memory_order_relaxed);
+  double minMs = monitor->minMs.load(std::memory_order_relaxed);
+  if (minMs < 0 || latencyMs < minMs) {
+    monitor->minMs.store(latencyMs, std::memory_order_relaxed);
+  }
+  if (latencyMs > monitor->maxMs.load(std::memory_order_relaxed)) {
+    monitor->maxMs.store(latencyMs, std::memory_order_relaxed);
+  }
+
+  float overrunMs = monitor->overrunMs.load(std::memory_order_relaxed);
+  bool overLimit = overrunMs > 0 && latencyMs > overrunMs;
+  if (overLimit && !monitor->overLimit) {
+    monitor->overruns.fetch_add(1, std::memory_order_relaxed);
+  }
+  monitor->overLimit = overLimit;
+
+  Uint64 now = SDL_GetTicksNS();
+  double dt = monitor->lastTicksNS ? (now - monitor->lastTicksNS) / 1e9 : 0.0;
+  monitor->lastTicksNS = now;
+  float targetMs = monitor->targetMs.load(std::memory_order_relaxed);
+  if (targetMs <= 0 || dt <= 0) {
+    return;
+  }
+
+  // Positive error means too much is queued, so play slightly fast.
+  double maxAdjust = monitor->maxAdjust.load(std::memory_order_relaxed);
+  double error = (smoothedMs - targetMs) / targetMs;
+  double integralLimit = maxAdjust / kMonitorIntegral;
+  monitor->integral = SDL_clamp(monitor->integral + error * dt, -integralLimit, integralLimit);
+  double adjust = SDL_clamp(kMonitorProportional * error + kMonitorIntegral * monitor->integral, -maxAdjust, maxAdjust);
+  double previous = monitor->ratio.load(std::memory_order_relaxed);
+  double ratio = SDL_clamp(1.0 + adjust, previous - kMonitorMaxRatioStep, previous + kMonitorMaxRatioStep);
+  if (ratio != previous) {
+    SDL_SetAudioStreamFrequencyRatio(stream, static_cast<float>(ratio));
+    monitor->ratio.store(ratio, std::memory_order_relaxed);
+  }
+}
+
+static bool GetMonitorOptions(const Value& value, float* targetMs, float* maxAdjust, float* overrunMs) {
+  if (value.IsUndefined()) {
+    return true;
+  }
+  if (!value.IsObject()) {
+    return false;
+  }
+  Object options = value.As<Object>();
+  Value target = options.Get("targetMs");
+  Value adjust = options.Get("maxAdjust");
+  Value overrun = options.Get("overrunMs");
+  if ((!target.IsUndefined() && !target.IsNumber()) || (!adjust.IsUndefined() && !adjust.IsNumber()) ||
+      (!overrun.IsUndefined() && !overrun.IsNumber())) {
+    return false;
+  }
+  if (target.IsNumber()) {
+    *targetMs = SDL_max(target.As<Number>().FloatValue(), 0.0f);
+    *overrunMs = *targetMs * 4;
+  }
+  if (adjust.IsNumber()) {
+    *maxAdjust = SDL_clamp(adjust.As<Number>().FloatValue(), 0.0f, 0.1f);
+  }
+  if (overrun.IsNumber()) {
+    *overrunMs = SDL_max(overrun.As<Number>().FloatValue(), 0.0f);
+  }
+  return true;
+}
+
+// enableAudioStreamMonitor(stream, { targetMs?, maxAdjust?, overrunMs? }?)
+//
+// Without targetMs the stream is only observed. overrunMs (default 4x the
+// target, off without one) is the queued latency counted as an overrun.
+Value Wrap_EnableAudioStreamMonitor(const CallbackInfo& info) {
+  Env env = info.Env();
+  float targetMs = 0.0f, maxAdjust = 0.005f, overrunMs = 0.0f;
+  if (info.Length() < 1 || info.Length() > 2 || !info[0].IsNumber() ||
+      !GetMonitorOptions(info.Length() == 2 ? info[1] : env.Undefined(), &targetMs, &maxAdjust, &overrunMs)) {
+    TypeError::New(env, "Expected stream pointer and optional { targetMs, maxAdjust, overrunMs }").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  AddonData* data = GetAddonData(env);
+  if (data->audioStreamPulls.count(stream)) {
+    Error::New(env, "Pull mode already owns this stream's get callback").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioSpec srcSpec;
+  if (!SDL_GetAudioStreamFormat(stream, &srcSpec, nullptr)) {
+    return Boolean::New(env, false);
+  }
+  double msPerByte = 1000.0 / (static_cast<double>(SDL_AUDIO_FRAMESIZE(srcSpec)) * srcSpec.freq);
+
+  ReleaseAudioStreamMonitor(env, stream);
+
+  AudioStreamMonitor* monitor = new AudioStreamMonitor(stream, msPerByte, targetMs, maxAdjust, overrunMs);
+  if (!SDL_SetAudioStreamGetCallback(stream, AudioStreamMonitorCallback, monitor)) {
+    delete monitor;
+    return Boolean::New(env, false);
+  }
+  data->audioStreamMonitors[stream] = monitor;
+  return Boolean::New(env, true);
+}
+
+Value Wrap_DisableAudioStreamMonitor(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  ReleaseAudioStreamMonitor(env, stream);
+  return env.Undefined();
+}
+
+// setAudioStreamTargetLatency(stream, targetMs) retargets a monitored stream;
+// 0 stops adapting and puts the frequency ratio back to 1.
+Value Wrap_SetAudioStreamTargetLatency(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer and target latency in milliseconds").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  std::unordered_map<SDL_AudioStream*, AudioStreamMonitor*>& monitors = GetAddonData(env)->audioStreamMonitors;
+  auto it = monitors.find(stream);
+  if (it == monitors.end()) {
+    return Boolean::New(env, false);
+  }
+
+  float targetMs = SDL_max(info[1].As<Number>().FloatValue(), 0.0f);
+  it->second->targetMs.store(targetMs, std::memory_order_relaxed);
+  if (targetMs == 0) {
+    // Hold the stream lock so this can't race a ratio update in the callback.
+    SDL_LockAudioStream(stream);
+    it->second->ratio.store(1.0, std::memory_order_relaxed);
+    it->second->integral = 0.0;
+    SDL_SetAudioStreamFrequencyRatio(stream, 1.0f);
+    SDL_UnlockAudioStream(stream);
+  }
+  return Boolean::New(env, true);
+}
+
+Value Wrap_GetAudioStreamMonitorStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  std::unordered_map<SDL_AudioStream*, AudioStreamMonitor*>& monitors = GetAddonData(env)->audioStreamMonitors;
+  auto it = monitors.find(stream);
+  if (it == monitors.end()) {
+    return env.Null();
+  }
+
+  AudioStreamMonitor* monitor = it->second;
+  int queued = SDL_GetAudioStreamQueued(stream);
+  int available = SDL_GetAudioStreamAvailable(stream);
+  SDL_AudioSpec dstSpec;
+  int dstFrameSize = SDL_GetAudioStreamFormat(stream, nullptr, &dstSpec) ? SDL_AUDIO_FRAMESIZE(dstSpec) : 0;
+
+  Object stats = Object::New(env);
+  stats.Set("queuedBytes", Number::New(env, queued));
+  stats.Set("availableBytes", Number::New(env, available));
+  stats.Set("availableFrames", Number::New(env, dstFrameSize && available > 0 ? available / dstFrameSize : 0));
+  stats.Set("latencyMs", Number::New(env, SDL_max(queued, 0) * monitor->msPerByte));
+  stats.Set("smoothedLatencyMs", Number::New(env, SDL_max(monitor->smoothedMs.load(), 0.0)));
+  stats.Set("minLatencyMs", Number::New(env, SDL_max(monitor->minMs.load(), 0.0)));
+  stats.Set("maxLatencyMs", Number::New(env, monitor->maxMs.load()));
+  stats.Set("targetMs", Number::New(env, monitor->targetMs.load()));
+  stats.Set("ratio", Number::New(env, monitor->ratio.load()));
+  stats.Set("callbacks", Number::New(env, static_cast<double>(monitor->callbacks.load())));
+  stats.Set("underruns", Number::New(env, static_cast<double>(monitor->underruns.load())));
+  stats.Set("underrunBytes", Number::New(env, static_cast<double>(monitor->underrunBytes.load())));
+  stats.Set("overruns", Number::New(env, static_cast<double>(monitor->overruns.load())));
+
+  // Device side, once the stream is bound.
+  SDL_AudioDeviceID devid = SDL_GetAudioStreamDevice(stream);
+  SDL_AudioSpec deviceSpec;
+  int deviceFrames = 0;
+  if (devid && SDL_GetAudioDeviceFormat(devid, &deviceSpec, &deviceFrames)) {
+    stats.Set("device", Number::New(env, devid));
+    stats.Set("deviceFreq", Number::New(env, deviceSpec.freq));
+    stats.Set("deviceBufferFrames", Number::New(env, deviceFrames));
+    stats.Set("deviceBufferMs", Number::New(env, deviceSpec.freq ? deviceFrames * 1000.0 / deviceSpec.freq : 0));
+  } else {
+    stats.Set("device", env.Null());
+  }
+  return stats;
+}
+
+// Audio capture
+//
+// Peak and RMS over one block of interleaved samples, all channels together.
+static void MeasureSamplesF32(const float* samples, size_t n, float* peak, float* rms) {
+  size_t i = 0;
+  float maxAbs = 0.0f;
+  float sumSquares = 0.0f;
+#if defined(SDL_NODE_SSE)
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  __m128 vmax = _mm_setzero_ps();
+  __m128 vsum = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(samples + i);
+    vmax = _mm_max_ps(vmax, _mm_andnot_ps(signMask, v));
+    vsum = _mm_add_ps(vsum, _mm_mul_ps(v, v));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, vmax);
+  maxAbs = SDL_max(SDL_max(lanes[0], lanes[1]), SDL_max(lanes[2], lanes[3]));
+  _mm_storeu_ps(lanes, vsum);
+  sumSquares = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(SDL_NODE_NEON)
+  float32x4_t vmax = vdupq_n_f32(0.0f);
+  float32x4_t vsum = vdupq_n_f32(0.0f);
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t v = vld1q_f32(samples + i);
+    vmax = vmaxq_f32(vmax, vabsq_f32(v));
+    vsum = vmlaq_f32(vsum, v, v);
+  }
+  float lanes[4];
+  vst1q_f32(lanes, vmax);
+  maxAbs = SDL_max(SDL_max(lanes[0], lanes[1]), SDL_max(lanes[2], lanes[3]));
+  vst1q_f32(lanes, vsum);
+  sumSquares = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+  for (; i < n; i++) {
+    maxAbs = SDL_max(maxAbs, SDL_fabsf(samples[i]));
+    sumSquares += samples[i] * samples[i];
+  }
+  *peak = maxAbs;
+  *rms = n ? SDL_sqrtf(sumSquares / n) : 0.0f;
+}
+
+static void MeasureSamplesS16(const Sint16* samples, size_t n, float* peak, float* rms) {
+  int maxAbs = 0;
+  double sumSquares = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    int s = samples[i];
+    maxAbs = SDL_max(maxAbs, s < 0 ? -s : s);
+    sumSquares += static_cast<double>(s) * s;
+  }
+  *peak = maxAbs / 32768.0f;
+  *rms = n ? static_cast<float>(SDL_sqrt(sumSquares / n) / 32768.0) : 0.0f;
+}
+
+static void MeasureBlock(const AudioStreamCapture* capture, const Uint8* block, float* peak, float* rms) {
+  if (capture->format == SDL_AUDIO_F32) {
+    MeasureSamplesF32(reinterpret_cast<const float*>(block), capture->blockBytes / sizeof(float), peak, rms);
+  } else {
+    MeasureSamplesS16(reinterpret_cast<const Sint16*>(block), capture->blockBytes / sizeof(Sint16), peak, rms);
+  }
+}
+
+// Runs on the JS thread: copies every complete block into the batch buffer,
+// meters each one and hands the lot to the callback.
+static void DeliverCaptureBlocks(AudioStreamCapture* capture, Env env, Function callback) {
+  capture->notifyPending.store(false, std::memory_order_release);
+
+  size_t count = SDL_min(capture->ring.Size() / capture->blockBytes, capture->maxBlocks);
+  if (count == 0) {
+    return;
+  }
+
+  Uint8* batch = static_cast<Uint8*>(capture->batch.Value().Data());
+  float* meters = capture->meters.Value().Data();
+  capture->ring.Read(batch, count * capture->blockBytes);
+  for (size_t i = 0; i < count; i++) {
+    MeasureBlock(capture, batch + i * capture->blockBytes, &meters[i * 2], &meters[i * 2 + 1]);
+  }
+
+  capture->batches++;
+  capture->blocks += count;
+  callback.Call({ capture->batch.Value(), Number::New(env, static_cast<double>(count)), capture->meters.Value() });
+}
+
+static void SDLCALL AudioStreamCaptureCallback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount) {
+  AudioStreamCapture* capture = static_cast<AudioStreamCapture*>(userdata);
+  capture->callbacks.fetch_add(1, std::memory_order_relaxed);
+
+  // Drain whatever the stream has converted so far; if JS has fallen behind
+  // the newest audio is dropped and counted rather than blocking the device.
+  int got;
+  while ((got = SDL_GetAudioStreamData(stream, capture->scratch.get(), static_cast<int>(capture->blockBytes))) > 0) {
+    size_t written = capture->ring.Write(capture->scratch.get(), static_cast<size_t>(got));
+    if (written < static_cast<size_t>(got)) {
+      capture->overruns.fetch_add(1, std::memory_order_relaxed);
+      capture->overrunBytes.fetch_add(got - written, std::memory_order_relaxed);
+    }
+  }
+
+  if (capture->ring.Size() >= capture->blockBytes && !capture->notifyPending.exchange(true, std::memory_order_acq_rel)) {
+    capture->tsfn.NonBlockingCall([capture](Env env, Function callback) {
+      DeliverCaptureBlocks(capture, env, callback);
+    });
+  }
+}
+
+// enableAudioStreamCapture(stream, blockBytes, maxBlocks, callback) calls
+// callback(buffer, blocks, meters) with `blocks` consecutive blocks at the
+// start of buffer and [peak, rms] per block in meters. Both are reused for the
+// next batch, so copy anything that must outlive the call.
+Value Wrap_EnableAudioStreamCapture(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 4 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber() ||
+      !info[3].IsFunction()) {
+    TypeError::New(env, "Expected stream pointer, block size, max blocks per batch and callback").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  Sint64 requestedBlockBytes = info[1].As<Number>().Int64Value();
+  Sint64 requestedMaxBlocks = info[2].As<Number>().Int64Value();
+  if (requestedBlockBytes <= 0 || requestedMaxBlocks <= 0 || requestedBlockBytes > SDL_MAX_SINT32 ||
+      requestedMaxBlocks > kMaxAudioRingBytes / requestedBlockBytes) {
+    RangeError::New(env, "Block size times max blocks must be between 1 byte and 64 MiB").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  size_t blockBytes = static_cast<size_t>(requestedBlockBytes);
+  size_t maxBlocks = static_cast<size_t>(requestedMaxBlocks);
+
+  SDL_AudioSpec dstSpec;
+  if (!SDL_GetAudioStreamFormat(stream, nullptr, &dstSpec)) {
+    return Boolean::New(env, false);
+  }
+  if (dstSpec.format != SDL_AUDIO_F32 && dstSpec.format != SDL_AUDIO_S16) {
+    RangeError::New(env, "Capture streams must output F32 or S16 samples").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (blockBytes == 0 || blockBytes % SDL_AUDIO_FRAMESIZE(dstSpec) != 0 || maxBlocks == 0) {
+    RangeError::New(env, "Block size must be a non-zero multiple of the sample frame size").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  ReleaseAudioStreamCapture(env, stream);
+
+  AudioStreamCapture* capture = new AudioStreamCapture(stream, blockBytes, maxBlocks, dstSpec.format);
+  capture->batch = Reference<ArrayBuffer>::New(ArrayBuffer::New(env, blockBytes * maxBlocks), 1);
+  capture->meters = Reference<Float32Array>::New(Float32Array::New(env, maxBlocks * 2), 1);
+  capture->tsfn = ThreadSafeFunction::New(env, info[3].As<Function>(), "sdl.audioStreamCapture", 0, 1,
+                                          [capture](Env env) { FinalizeAudioStreamCapture(env, capture); });
+  capture->tsfn.Unref(env);
+
+  if (!SDL_SetAudioStreamPutCallback(stream, AudioStreamCaptureCallback, capture)) {
+    capture->tsfn.Release();
+    return Boolean::New(env, false);
+  }
+  GetAddonData(env)->audioStreamCaptures[stream] = capture;
+  return Boolean::New(env, true);
+}
+
+Value Wrap_DisableAudioStreamCapture(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  ReleaseAudioStreamCapture(env, stream);
+  return env.Undefined();
 }
 
-Value Wrap_SDL_LoadWAV(const CallbackInfo& info) {
+Value Wrap_GetAudioStreamCaptureStats(const CallbackInfo& info) {
   Env env = info.Env();
-  if (info.Length() != 1 || !info[0].IsString()) {
-    TypeError::New(env, "Expected file path string").ThrowAsJavaScriptException();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected stream pointer").ThrowAsJavaScriptException();
     return env.Undefined();
   }
 
-  std::string path = info[0].As<String>().Utf8Value();
-  SDL_AudioSpec spec;
-  Uint8* audio_buf;
-  Uint32 audio_len;
+  SDL_AudioStream* stream = reinterpret_cast<SDL_AudioStream*>(info[0].As<Number>().Int64Value());
+  std::unordered_map<SDL_AudioStream*, AudioStreamCapture*>& captures = GetAddonData(env)->audioStreamCaptures;
+  auto it = captures.find(stream);
+  if (it == captures.end()) {
+    return env.Null();
+  }
 
-  bool result = SDL_LoadWAV(path.c_str(), &spec, &audio_buf, &audio_len);
-  if (!result) {
+  AudioStreamCapture* capture = it->second;
+  Object stats = Object::New(env);
+  stats.Set("buffered", Number::New(env, static_cast<double>(capture->ring.Size())));
+  stats.Set("capacity", Number::New(env, static_cast<double>(capture->ring.Capacity())));
+  stats.Set("callbacks", Number::New(env, static_cast<double>(capture->callbacks.load())));
+  stats.Set("overruns", Number::New(env, static_cast<double>(capture->overruns.load())));
+  stats.Set("overrunBytes", Number::New(env, static_cast<double>(capture->overrunBytes.load())));
+  stats.Set("batches", Number::New(env, static_cast<double>(capture->batches)));
+  stats.Set("blocks", Number::New(env, static_cast<double>(capture->blocks)));
+  return stats;
+}
+
+// Native mixer
+//
+// A mixer owns an F32 stereo audio stream bound to a device and mixes its
+// voices from SDL's audio thread in a get callback. Sounds reference the
+// caller's decoded PCM (F32 or S16, mono or stereo) without copying. JS never
+// touches voice state directly: play/stop/set go through a lock-free command
+// ring, and only adding or removing sounds takes the stream lock.
+static const int kMixChunkFrames = 512;
+static const int kMixerCommandCapacity = 1024;
+// Upper bound on voice pitch; also keeps the per-frame step to a few source
+// frames so a voice can never skip past a whole short sound in one go.
+static const float kMaxMixerPitch = 16.0f;
+static const float kMaxMixerGain = 16.0f;
+
+struct MixerSound {
+  ObjectReference buffer;
+  const Uint8* data;
+  size_t frames;
+  SDL_AudioFormat format;
+  int channels;
+  int freq;
+};
+
+struct MixerVoice {
+  Uint32 id;
+  const MixerSound* sound;
+  double position;
+  double step;
+  float pitch;
+  float gainL;
+  float gainR;
+  bool loop;
+};
+
+enum MixerCommandType {
+  MIXER_CMD_PLAY,
+  MIXER_CMD_STOP,
+  MIXER_CMD_SET,
+  MIXER_CMD_STOP_ALL
+};
+
+struct MixerCommand {
+  MixerCommandType type;
+  Uint32 voiceId;
+  const MixerSound* sound;
+  float gain;
+  float pan;
+  float pitch;
+  bool loop;
+  double offset;
+};
+
+struct Mixer {
+  SDL_AudioStream* stream;
+  int freq;
+  SpscRing commands;
+  std::vector<MixerVoice> voices;
+  size_t maxVoices;
+  float mixBuffer[kMixChunkFrames * 2];
+  float voiceBuffer[kMixChunkFrames * 2];
+
+  // JS thread only
+  std::unordered_map<Uint32, std::unique_ptr<MixerSound>> sounds;
+  Uint32 nextSoundId = 1;
+  Uint32 nextVoiceId = 1;
+
+  std::atomic<Uint64> callbacks{0};
+  std::atomic<Uint64> voicesMixed{0};
+  std::atomic<Uint64> voicesDropped{0};
+  std::atomic<Uint64> callbackTicks{0};
+  std::atomic<Uint64> maxCallbackTicks{0};
+  std::atomic<int> playing{0};
+
+  Mixer(SDL_AudioStream* stream, int freq, int maxVoices)
+      : stream(stream), freq(freq), commands(kMixerCommandCapacity * sizeof(MixerCommand)), maxVoices(maxVoices) {
+    voices.reserve(maxVoices);
+  }
+};
+
+// dst[i] += src[i] * gain over interleaved stereo, gain alternating L/R.
+static void MixAccumulateStereo(float* dst, const float* src, float gainL, float gainR, int frames) {
+  int n = frames * 2;
+  int i = 0;
+#if defined(SDL_NODE_SSE)
+  __m128 gain = _mm_setr_ps(gainL, gainR, gainL, gainR);
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), gain)));
+  }
+#elif defined(SDL_NODE_NEON)
+  const float gains[4] = { gainL, gainR, gainL, gainR };
+  float32x4_t gain = vld1q_f32(gains);
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(dst + i, vmlaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+  }
+#endif
+  for (; i < n; i += 2) {
+    dst[i] += src[i] * gainL;
+    dst[i + 1] += src[i + 1] * gainR;
+  }
+}
+
+static void ClampSamples(float* samples, int n) {
+  int i = 0;
+#if defined(SDL_NODE_SSE)
+  __m128 lo = _mm_set1_ps(-1.0f);
+  __m128 hi = _mm_set1_ps(1.0f);
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(samples + i, _mm_max_ps(lo, _mm_min_ps(hi, _mm_loadu_ps(samples + i))));
+  }
+#elif defined(SDL_NODE_NEON)
+  float32x4_t lo = vdupq_n_f32(-1.0f);
+  float32x4_t hi = vdupq_n_f32(1.0f);
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(samples + i, vmaxq_f32(lo, vminq_f32(hi, vld1q_f32(samples + i))));
+  }
+#endif
+  for (; i < n; i++) {
+    samples[i] = SDL_clamp(samples[i], -1.0f, 1.0f);
+  }
+}
+
+static float ReadSoundSample(const MixerSound* sound, size_t frame, int channel) {
+  size_t index = frame * sound->channels + (sound->channels == 1 ? 0 : channel);
+  if (sound->format == SDL_AUDIO_F32) {
+    return reinterpret_cast<const float*>(sound->data)[index];
+  }
+  return reinterpret_cast<const Sint16*>(sound->data)[index] * (1.0f / 32768.0f);
+}
+
+static void SetVoiceGain(MixerVoice* voice, float gain, float pan) {
+  // Equal-power pan, pan in -1..1
+  float angle = (SDL_clamp(pan, -1.0f, 1.0f) + 1.0f) * (SDL_PI_F / 4.0f);
+  voice->gainL = gain * SDL_cosf(angle);
+  voice->gainR = gain * SDL_sinf(angle);
+}
+
+// Mixes up to frames of one voice into mixBuffer, returning false once a
+// non-looping voice has run off the end of its sound.
+static bool MixVoice(Mixer* mixer, MixerVoice* voice, int frames) {
+  const MixerSound* sound = voice->sound;
+  float* dst = mixer->mixBuffer;
+  int done = 0;
+
+  // Fast path: F32 stereo at unity step is mixed straight from the source.
+  if (voice->step == 1.0 && sound->format == SDL_AUDIO_F32 && sound->channels == 2 &&
+      voice->position == SDL_floor(voice->position)) {
+    while (done < frames) {
+      size_t pos = static_cast<size_t>(voice->position);
+      int run = static_cast<int>(SDL_min(static_cast<size_t>(frames - done), sound->frames - pos));
+      MixAccumulateStereo(dst + done * 2, reinterpret_cast<const float*>(sound->data) + pos * 2,
+                          voice->gainL, voice->gainR, run);
+      done += run;
+      voice->position += run;
+      if (voice->position >= sound->frames) {
+        if (!voice->loop) {
+          return false;
+        }
+        voice->position = 0;
+      }
+    }
+    return true;
+  }
+
+  // General path: linear-interpolated resample into voiceBuffer first.
+  float* out = mixer->voiceBuffer;
+  bool alive = true;
+  for (; done < frames; done++) {
+    if (voice->position >= sound->frames) {
+      if (!voice->loop) {
+        alive = false;
+        break;
+      }
+      // A step larger than the sound can overshoot by more than one length.
+      voice->position = SDL_fmod(voice->position, static_cast<double>(sound->frames));
+    }
+    size_t i0 = static_cast<size_t>(voice->position);
+    size_t i1 = i0 + 1 < sound->frames ? i0 + 1 : (voice->loop ? 0 : i0);
+    float t = static_cast<float>(voice->position - i0);
+    for (int c = 0; c < 2; c++) {
+      float a = ReadSoundSample(sound, i0, c);
+      float b = ReadSoundSample(sound, i1, c);
+      out[done * 2 + c] = a + (b - a) * t;
+    }
+    voice->position += voice->step;
+  }
+  MixAccumulateStereo(dst, out, voice->gainL, voice->gainR, done);
+  return alive;
+}
+
+static MixerVoice* FindVoice(Mixer* mixer, Uint32 id) {
+  for (MixerVoice& voice : mixer->voices) {
+    if (voice.id == id) {
+      return &voice;
+    }
+  }
+  return nullptr;
+}
+
+// Runs on the audio thread, or on the JS thread while it holds the stream lock.
+static void ProcessMixerCommands(Mixer* mixer) {
+  MixerCommand cmd;
+  while (mixer->commands.Size() >= sizeof(cmd)) {
+    mixer->commands.Read(&cmd, sizeof(cmd));
+    switch (cmd.type) {
+      case MIXER_CMD_PLAY: {
+        if (mixer->voices.size() == mixer->maxVoices) {
+          mixer->voicesDropped.fetch_add(1, std::memory_order_relaxed);
+          break;
+        }
+        MixerVoice voice;
+        voice.id = cmd.voiceId;
+        voice.sound = cmd.sound;
+        voice.position = SDL_min(cmd.offset, static_cast<double>(cmd.sound->frames));
+        voice.pitch = cmd.pitch;
+        voice.step = static_cast<double>(cmd.pitch) * cmd.sound->freq / mixer->freq;
+        voice.loop = cmd.loop;
+        SetVoiceGain(&voice, cmd.gain, cmd.pan);
+        mixer->voices.push_back(voice);
+        break;
+      }
+      case MIXER_CMD_STOP:
+      case MIXER_CMD_SET: {
+        MixerVoice* voice = FindVoice(mixer, cmd.voiceId);
+        if (!voice) {
+          break;
+        }
+        if (cmd.type == MIXER_CMD_STOP) {
+          *voice = mixer->voices.back();
+          mixer->voices.pop_back();
+        } else {
+          SetVoiceGain(voice, cmd.gain, cmd.pan);
+          voice->pitch = cmd.pitch;
+          voice->step = static_cast<double>(cmd.pitch) * voice->sound->freq / mixer->freq;
+        }
+        break;
+      }
+      case MIXER_CMD_STOP_ALL:
+        mixer->voices.clear();
+        break;
+    }
+  }
+}
+
+static void SDLCALL MixerCallback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount) {
+  Mixer* mixer = static_cast<Mixer*>(userdata);
+  Uint64 start = SDL_GetPerformanceCounter();
+
+  ProcessMixerCommands(mixer);
+
+  int remaining = additional_amount / static_cast<int>(sizeof(float) * 2);
+  Uint64 mixed = 0;
+  while (remaining > 0) {
+    int frames = SDL_min(remaining, kMixChunkFrames);
+    memset(mixer->mixBuffer, 0, sizeof(float) * 2 * frames);
+    for (size_t i = 0; i < mixer->voices.size();) {
+      mixed++;
+      if (MixVoice(mixer, &mixer->voices[i], frames)) {
+        i++;
+      } else {
+        mixer->voices[i] = mixer->voices.back();
+        mixer->voices.pop_back();
+      }
+    }
+    ClampSamples(mixer->mixBuffer, frames * 2);
+    SDL_PutAudioStreamData(stream, mixer->mixBuffer, static_cast<int>(sizeof(float) * 2 * frames));
+    remaining -= frames;
+  }
+
+  Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+  mixer->callbacks.fetch_add(1, std::memory_order_relaxed);
+  mixer->voicesMixed.fetch_add(mixed, std::memory_order_relaxed);
+  mixer->callbackTicks.fetch_add(elapsed, std::memory_order_relaxed);
+  if (elapsed > mixer->maxCallbackTicks.load(std::memory_order_relaxed)) {
+    mixer->maxCallbackTicks.store(elapsed, std::memory_order_relaxed);
+  }
+  mixer->playing.store(static_cast<int>(mixer->voices.size()), std::memory_order_relaxed);
+}
+
+// Looks a mixer handle up in this env's registry, throwing for unknown or
+// destroyed handles.
+static Mixer* GetMixer(Env env, const Value& value) {
+  Mixer* mixer = reinterpret_cast<Mixer*>(value.As<Number>().Int64Value());
+  if (!GetAddonData(env)->mixers.count(mixer)) {
+    RangeError::New(env, "Unknown mixer").ThrowAsJavaScriptException();
+    return nullptr;
+  }
+  return mixer;
+}
+
+// Gain and pan reach the audio thread as-is, and a non-finite or huge gain
+// would turn the whole mix into NaN or Inf, which ClampSamples passes on.
+static bool IsValidVoiceGain(float gain, float pan) {
+  return !SDL_isnanf(gain) && !SDL_isinff(gain) && SDL_fabsf(gain) <= kMaxMixerGain && !SDL_isnanf(pan) &&
+         !SDL_isinff(pan);
+}
+
+static bool PushMixerCommand(Mixer* mixer, const MixerCommand& cmd) {
+  if (mixer->commands.Capacity() - mixer->commands.Size() < sizeof(cmd)) {
+    return false;
+  }
+  mixer->commands.Write(&cmd, sizeof(cmd));
+  return true;
+}
+
+Value Wrap_CreateMixer(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 1 || info.Length() > 2 || !info[0].IsNumber() || (info.Length() == 2 && !info[1].IsNumber())) {
+    TypeError::New(env, "Expected device ID and optional max voices").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  SDL_AudioDeviceID devid = info[0].As<Number>().Uint32Value();
+  int maxVoices = info.Length() == 2 ? info[1].As<Number>().Int32Value() : 64;
+
+  SDL_AudioSpec deviceSpec;
+  if (!SDL_GetAudioDeviceFormat(devid, &deviceSpec, nullptr)) {
     return env.Null();
   }
 
-  // Create ArrayBuffer with the audio data
-  ArrayBuffer buffer = ArrayBuffer::New(env, audio_len);
-  memcpy(buffer.Data(), audio_buf, audio_len);
-  SDL_free(audio_buf);
+  SDL_AudioSpec spec = { SDL_AUDIO_F32, 2, deviceSpec.freq };
+  SDL_AudioStream* stream = SDL_CreateAudioStream(&spec, &deviceSpec);
+  if (!stream) {
+    return env.Null();
+  }
 
-  // Return object with spec and buffer
-  Object returnObj = Object::New(env);
-  Object specObj = Object::New(env);
-  specObj.Set("format", Number::New(env, spec.format));
-  specObj.Set("channels", Number::New(env, spec.channels));
-  specObj.Set("freq", Number::New(env, spec.freq));
+  Mixer* mixer = new Mixer(stream, spec.freq, SDL_max(maxVoices, 1));
+  if (!SDL_SetAudioStreamGetCallback(stream, MixerCallback, mixer) || !SDL_BindAudioStream(devid, stream)) {
+    SDL_DestroyAudioStream(stream);
+    delete mixer;
+    return env.Null();
+  }
 
-  returnObj.Set("spec", specObj);
-  returnObj.Set("buffer", buffer);
-  returnObj.Set("length", Number::New(env, audio_len));
+  GetAddonData(env)->mixers[mixer] = true;
+  return Number::New(env, reinterpret_cast<uintptr_t>(mixer));
+}
 
-  return returnObj;
+Value Wrap_DestroyMixer(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected mixer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // Only handles still registered may be freed, so a second destroy is a no-op.
+  Mixer* mixer = reinterpret_cast<Mixer*>(info[0].As<Number>().Int64Value());
+  if (!GetAddonData(env)->mixers.erase(mixer)) {
+    return Boolean::New(env, false);
+  }
+  SDL_DestroyAudioStream(mixer->stream);
+  delete mixer;
+  return Boolean::New(env, true);
+}
+
+Value Wrap_MixerAddSound(const CallbackInfo& info) {
+  Env env = info.Env();
+  void* data = nullptr;
+  size_t length = 0;
+  if (info.Length() != 3 || !info[0].IsNumber() || !GetBufferData(info[1], &data, &length) || !info[2].IsObject()) {
+    TypeError::New(env, "Expected mixer, PCM buffer and audio spec object").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Mixer* mixer = GetMixer(env, info[0]);
+  if (!mixer) {
+    return env.Undefined();
+  }
+  Object specObj = info[2].As<Object>();
+  SDL_AudioFormat format = static_cast<SDL_AudioFormat>(specObj.Get("format").As<Number>().Uint32Value());
+  int channels = specObj.Get("channels").As<Number>().Int32Value();
+  int freq = specObj.Get("freq").As<Number>().Int32Value();
+  if ((format != SDL_AUDIO_F32 && format != SDL_AUDIO_S16) || (channels != 1 && channels != 2) || freq <= 0) {
+    RangeError::New(env, "Mixer sounds must be F32 or S16, mono or stereo").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (reinterpret_cast<uintptr_t>(data) % SDL_AUDIO_BYTESIZE(format) != 0) {
+    RangeError::New(env, "PCM buffer is not aligned to its sample size").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  std::unique_ptr<MixerSound> sound(new MixerSound());
+  sound->buffer = Persistent(info[1].As<Object>());
+  sound->data = static_cast<const Uint8*>(data);
+  sound->frames = length / (SDL_AUDIO_BYTESIZE(format) * channels);
+  if (sound->frames == 0) {
+    RangeError::New(env, "PCM buffer must contain at least one sample frame").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  sound->format = format;
+  sound->channels = channels;
+  sound->freq = freq;
+
+  Uint32 id = mixer->nextSoundId++;
+  mixer->sounds[id] = std::move(sound);
+  return Number::New(env, id);
+}
+
+Value Wrap_MixerRemoveSound(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    TypeError::New(env, "Expected mixer and sound ID").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Mixer* mixer = GetMixer(env, info[0]);
+  if (!mixer) {
+    return env.Undefined();
+  }
+  auto it = mixer->sounds.find(info[1].As<Number>().Uint32Value());
+  if (it == mixer->sounds.end()) {
+    return Boolean::New(env, false);
+  }
+
+  // Holding the stream lock keeps the callback out while queued commands are
+  // applied and any voices still using the sound are dropped.
+  SDL_LockAudioStream(mixer->stream);
+  ProcessMixerCommands(mixer);
+  const MixerSound* sound = it->second.get();
+  for (size_t i = 0; i < mixer->voices.size();) {
+    if (mixer->voices[i].sound == sound) {
+      mixer->voices[i] = mixer->voices.back();
+      mixer->voices.pop_back();
+    } else {
+      i++;
+    }
+  }
+  SDL_UnlockAudioStream(mixer->stream);
+
+  mixer->sounds.erase(it);
+  return Boolean::New(env, true);
+}
+
+// mixerPlay(mixer, soundId, { gain, pan, loop, offset, pitch }) returns a
+// voice ID, or -1 if the command ring is full.
+Value Wrap_MixerPlay(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 2 || info.Length() > 3 || !info[0].IsNumber() || !info[1].IsNumber() ||
+      (info.Length() == 3 && !info[2].IsObject())) {
+    TypeError::New(env, "Expected mixer, sound ID and optional voice options").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Mixer* mixer = GetMixer(env, info[0]);
+  if (!mixer) {
+    return env.Undefined();
+  }
+  auto it = mixer->sounds.find(info[1].As<Number>().Uint32Value());
+  if (it == mixer->sounds.end()) {
+    RangeError::New(env, "Unknown sound ID").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  MixerCommand cmd = {};
+  cmd.type = MIXER_CMD_PLAY;
+  cmd.voiceId = mixer->nextVoiceId++;
+  cmd.sound = it->second.get();
+  cmd.gain = 1.0f;
+  cmd.pitch = 1.0f;
+  if (info.Length() == 3) {
+    Object options = info[2].As<Object>();
+    Value gain = options.Get("gain");
+    Value pan = options.Get("pan");
+    Value loop = options.Get("loop");
+    Value offset = options.Get("offset");
+    Value pitch = options.Get("pitch");
+    if (gain.IsNumber()) cmd.gain = gain.As<Number>().FloatValue();
+    if (pan.IsNumber()) cmd.pan = pan.As<Number>().FloatValue();
+    if (loop.IsBoolean()) cmd.loop = loop.As<Boolean>().Value();
+    if (offset.IsNumber()) cmd.offset = SDL_max(offset.As<Number>().DoubleValue(), 0.0);
+    if (pitch.IsNumber()) cmd.pitch = SDL_min(SDL_max(pitch.As<Number>().FloatValue(), 0.0f), kMaxMixerPitch);
+  }
+  if (!IsValidVoiceGain(cmd.gain, cmd.pan)) {
+    RangeError::New(env, "Gain must be finite and at most 16, pan finite").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  if (!PushMixerCommand(mixer, cmd)) {
+    return Number::New(env, -1);
+  }
+  return Number::New(env, cmd.voiceId);
+}
+
+Value Wrap_MixerStop(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() < 1 || info.Length() > 2 || !info[0].IsNumber() || (info.Length() == 2 && !info[1].IsNumber())) {
+    TypeError::New(env, "Expected mixer and optional voice ID").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Mixer* mixer = GetMixer(env, info[0]);
+  if (!mixer) {
+    return env.Undefined();
+  }
+  MixerCommand cmd = {};
+  cmd.type = info.Length() == 2 ? MIXER_CMD_STOP : MIXER_CMD_STOP_ALL;
+  cmd.voiceId = info.Length() == 2 ? info[1].As<Number>().Uint32Value() : 0;
+  return Boolean::New(env, PushMixerCommand(mixer, cmd));
+}
+
+Value Wrap_MixerSetVoice(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 5 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber() ||
+      !info[3].IsNumber() || !info[4].IsNumber()) {
+    TypeError::New(env, "Expected mixer, voice ID, gain, pan, pitch").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Mixer* mixer = GetMixer(env, info[0]);
+  if (!mixer) {
+    return env.Undefined();
+  }
+  MixerCommand cmd = {};
+  cmd.type = MIXER_CMD_SET;
+  cmd.voiceId = info[1].As<Number>().Uint32Value();
+  cmd.gain = info[2].As<Number>().FloatValue();
+  cmd.pan = info[3].As<Number>().FloatValue();
+  cmd.pitch = SDL_min(SDL_max(info[4].As<Number>().FloatValue(), 0.0f), kMaxMixerPitch);
+  if (!IsValidVoiceGain(cmd.gain, cmd.pan)) {
+    RangeError::New(env, "Gain must be finite and at most 16, pan finite").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  return Boolean::New(env, PushMixerCommand(mixer, cmd));
+}
+
+Value Wrap_GetMixerStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsNumber()) {
+    TypeError::New(env, "Expected mixer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Mixer* mixer = GetMixer(env, info[0]);
+  if (!mixer) {
+    return env.Undefined();
+  }
+  double msPerTick = 1000.0 / SDL_GetPerformanceFrequency();
+  Uint64 callbacks = mixer->callbacks.load();
+
+  Object stats = Object::New(env);
+  stats.Set("callbacks", Number::New(env, static_cast<double>(callbacks)));
+  stats.Set("voicesMixed", Number::New(env, static_cast<double>(mixer->voicesMixed.load())));
+  stats.Set("voicesDropped", Number::New(env, static_cast<double>(mixer->voicesDropped.load())));
+  stats.Set("playing", Number::New(env, mixer->playing.load()));
+  stats.Set("sounds", Number::New(env, static_cast<double>(mixer->sounds.size())));
+  stats.Set("avgCallbackMs", Number::New(env, callbacks ? mixer->callbackTicks.load() * msPerTick / callbacks : 0));
+  stats.Set("maxCallbackMs", Number::New(env, mixer->maxCallbackTicks.load() * msPerTick));
+  return stats;
+}
+
+// Stats snapshot layout (Float64Array), see getStatsLayout:
+//   [0] frames  [1] audio bytes put  [2] audio bytes got
+//   [3 + 3i] calls, total ms, max ms for binding i
+//   then kFrameHistogramBuckets frame-time counts
+static const int kStatsHeaderSize = 3;
+
+static size_t GetStatsSize(const Stats& stats) {
+  return kStatsHeaderSize + stats.bindingCount * 3 + kFrameHistogramBuckets;
+}
+
+Value Wrap_SetStatsEnabled(const CallbackInfo& info) {
+  Env env = info.Env();
+  Stats& stats = GetAddonData(env)->stats;
+  if (info.Length() != 1 || !info[0].IsBoolean()) {
+    TypeError::New(env, "Expected boolean").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  stats.enabled = info[0].As<Boolean>().Value();
+  stats.lastPresentTicks = 0;
+  return env.Undefined();
+}
+
+Value Wrap_ResetStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  Stats& stats = GetAddonData(env)->stats;
+  for (int i = 0; i < stats.bindingCount; i++) {
+    stats.bindings[i].calls = 0;
+    stats.bindings[i].ticks = 0;
+    stats.bindings[i].maxTicks = 0;
+  }
+  stats.audioBytesPut = 0;
+  stats.audioBytesGot = 0;
+  stats.frames = 0;
+  stats.lastPresentTicks = 0;
+  memset(stats.frameHistogram, 0, sizeof(stats.frameHistogram));
+  return env.Undefined();
+}
+
+Value Wrap_GetStatsLayout(const CallbackInfo& info) {
+  Env env = info.Env();
+  const Stats& stats = GetAddonData(env)->stats;
+  Array names = Array::New(env, stats.bindingCount);
+  for (int i = 0; i < stats.bindingCount; i++) {
+    names.Set(i, String::New(env, stats.bindings[i].name));
+  }
+
+  Object layout = Object::New(env);
+  layout.Set("size", Number::New(env, static_cast<double>(GetStatsSize(stats))));
+  layout.Set("bindings", names);
+  layout.Set("bindingOffset", Number::New(env, kStatsHeaderSize));
+  layout.Set("histogramOffset", Number::New(env, kStatsHeaderSize + stats.bindingCount * 3));
+  layout.Set("histogramBuckets", Number::New(env, kFrameHistogramBuckets));
+  layout.Set("histogramBucketMs", Number::New(env, kFrameHistogramBucketMs));
+  return layout;
+}
+
+Value Wrap_GetStats(const CallbackInfo& info) {
+  Env env = info.Env();
+  if (info.Length() != 1 || !info[0].IsTypedArray() ||
+      info[0].As<TypedArray>().TypedArrayType() != napi_float64_array) {
+    TypeError::New(env, "Expected Float64Array").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  const Stats& stats = GetAddonData(env)->stats;
+  Float64Array out = info[0].As<Float64Array>();
+  size_t size = GetStatsSize(stats);
+  if (out.ElementLength() < size) {
+    RangeError::New(env, "Stats buffer is smaller than getStatsLayout().size").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  double* data = out.Data();
+  double msPerTick = 1000.0 / SDL_GetPerformanceFrequency();
+  data[0] = static_cast<double>(stats.frames);
+  data[1] = static_cast<double>(stats.audioBytesPut);
+  data[2] = static_cast<double>(stats.audioBytesGot);
+  double* binding = data + kStatsHeaderSize;
+  for (int i = 0; i < stats.bindingCount; i++, binding += 3) {
+    binding[0] = static_cast<double>(stats.bindings[i].calls);
+    binding[1] = stats.bindings[i].ticks * msPerTick;
+    binding[2] = stats.bindings[i].maxTicks * msPerTick;
+  }
+  for (int i = 0; i < kFrameHistogramBuckets; i++) {
+    binding[i] = static_cast<double>(stats.frameHistogram[i]);
+  }
+  return Number::New(env, static_cast<double>(size));
+}
+
+AddonData::~AddonData() {
+  // Tsfn finalizers normally detach pull and capture callbacks first; this
+  // covers anything left once the env is going away.
+  for (const auto& entry : audioStreamPulls) {
+    SDL_SetAudioStreamGetCallback(entry.first, nullptr, nullptr);
+  }
+  for (const auto& entry : audioStreamCaptures) {
+    SDL_SetAudioStreamPutCallback(entry.first, nullptr, nullptr);
+  }
+  for (const auto& entry : audioStreamMonitors) {
+    SDL_SetAudioStreamGetCallback(entry.first, nullptr, nullptr);
+    delete entry.second;
+  }
+  for (const auto& entry : mixers) {
+    SDL_DestroyAudioStream(entry.first->stream);
+    delete entry.first;
+  }
+  // SDL rejects cache textures already destroyed along with their renderer.
+  for (const auto& entry : textCaches) {
+    SDL_DestroyTexture(entry.first->atlas);
+    delete entry.first;
+  }
+  for (const auto& entry : displayLists) {
+    SDL_DestroyTexture(entry.first->cache);
+    delete entry.first;
+  }
+  if (eventFilter) {
+    SDL_SetEventFilter(nullptr, nullptr);
+  }
+  QuitEnvSubsystems(this);
 }
 
+#define EXPORT_BINDING(name, fn) \
+  exports.Set(name, Function::New(env, Profiled<fn>, name, RegisterBindingStat(&data->stats, name)))
+
+#define EXPORT_MAIN_THREAD_BINDING(name, fn) \
+  exports.Set(name, Function::New(env, Profiled<MainThreadOnly<fn>>, name, RegisterBindingStat(&data->stats, name)))
+
 Object Init (Env env, Object exports) {
-  exports.Set("init", Function::New(env, Wrap_SDL_Init));
-  exports.Set("quit", Function::New(env, Wrap_SDL_Quit));
-  exports.Set("getError", Function::New(env, Wrap_SDL_GetError));
-  exports.Set("delay", Function::New(env, Wrap_SDL_Delay));
+  // Runs once per environment; every exported function closes over this env's
+  // own stats, so nothing here is shared with other workers.
+  AddonData* data = new AddonData();
+  env.SetInstanceData(data);
+  SDL_ThreadID noThread = 0;
+  g_mainThreadID.compare_exchange_strong(noThread, SDL_GetCurrentThreadID());
+
+  EXPORT_BINDING("init", Wrap_SDL_Init);
+  EXPORT_BINDING("quit", Wrap_SDL_Quit);
+  EXPORT_BINDING("getError", Wrap_SDL_GetError);
+  EXPORT_BINDING("delay", Wrap_SDL_Delay);
 
   // Video functions
-  exports.Set("createWindow", Function::New(env, Wrap_SDL_CreateWindow));
-  exports.Set("destroyWindow", Function::New(env, Wrap_SDL_DestroyWindow));
-  exports.Set("createRenderer", Function::New(env, Wrap_SDL_CreateRenderer));
-  exports.Set("destroyRenderer", Function::New(env, Wrap_SDL_DestroyRenderer));
-  exports.Set("setRenderDrawColor", Function::New(env, Wrap_SDL_SetRenderDrawColor));
-  exports.Set("renderClear", Function::New(env, Wrap_SDL_RenderClear));
-  exports.Set("renderRect", Function::New(env, Wrap_SDL_RenderRect));
-  exports.Set("renderPresent", Function::New(env, Wrap_SDL_RenderPresent));
-  exports.Set("pollEvent", Function::New(env, Wrap_SDL_PollEvent));
+  EXPORT_MAIN_THREAD_BINDING("createWindow", Wrap_SDL_CreateWindow);
+  EXPORT_MAIN_THREAD_BINDING("destroyWindow", Wrap_SDL_DestroyWindow);
+  EXPORT_MAIN_THREAD_BINDING("createRenderer", Wrap_SDL_CreateRenderer);
+  EXPORT_MAIN_THREAD_BINDING("destroyRenderer", Wrap_SDL_DestroyRenderer);
+  EXPORT_MAIN_THREAD_BINDING("setRenderDrawColor", Wrap_SDL_SetRenderDrawColor);
+  EXPORT_MAIN_THREAD_BINDING("renderClear", Wrap_SDL_RenderClear);
+  EXPORT_MAIN_THREAD_BINDING("renderRect", Wrap_SDL_RenderRect);
+  EXPORT_MAIN_THREAD_BINDING("renderPresent", Wrap_SDL_RenderPresent);
+  EXPORT_MAIN_THREAD_BINDING("renderRects", Wrap_SDL_RenderRects);
+  EXPORT_MAIN_THREAD_BINDING("renderFillRects", Wrap_SDL_RenderFillRects);
+  EXPORT_MAIN_THREAD_BINDING("renderLines", Wrap_SDL_RenderLines);
+  EXPORT_MAIN_THREAD_BINDING("renderPoints", Wrap_SDL_RenderPoints);
+  EXPORT_MAIN_THREAD_BINDING("submitRenderCommands", Wrap_SubmitRenderCommands);
+  EXPORT_MAIN_THREAD_BINDING("createTexture", Wrap_SDL_CreateTexture);
+  EXPORT_MAIN_THREAD_BINDING("destroyTexture", Wrap_SDL_DestroyTexture);
+  EXPORT_MAIN_THREAD_BINDING("updateTexture", Wrap_SDL_UpdateTexture);
+  EXPORT_MAIN_THREAD_BINDING("updateYUVTexture", Wrap_SDL_UpdateYUVTexture);
+  EXPORT_MAIN_THREAD_BINDING("lockTexture", Wrap_SDL_LockTexture);
+  EXPORT_MAIN_THREAD_BINDING("unlockTexture", Wrap_SDL_UnlockTexture);
+  EXPORT_MAIN_THREAD_BINDING("renderTexture", Wrap_SDL_RenderTexture);
+  EXPORT_MAIN_THREAD_BINDING("setRenderTarget", Wrap_SDL_SetRenderTarget);
+  EXPORT_MAIN_THREAD_BINDING("readPixels", Wrap_SDL_RenderReadPixels);
+  EXPORT_MAIN_THREAD_BINDING("readPixelsAsync", Wrap_ReadPixelsAsync);
+  EXPORT_MAIN_THREAD_BINDING("getCaptureStats", Wrap_GetCaptureStats);
+  EXPORT_MAIN_THREAD_BINDING("createTextureFromSurface", Wrap_SDL_CreateTextureFromSurface);
+  EXPORT_MAIN_THREAD_BINDING("updateTextureFromSurface", Wrap_UpdateTextureFromSurface);
+  EXPORT_MAIN_THREAD_BINDING("renderGeometry", Wrap_SDL_RenderGeometry);
+  EXPORT_MAIN_THREAD_BINDING("renderSprites", Wrap_RenderSprites);
+  EXPORT_MAIN_THREAD_BINDING("renderDebugText", Wrap_SDL_RenderDebugText);
+  EXPORT_MAIN_THREAD_BINDING("createTextCache", Wrap_CreateTextCache);
+  EXPORT_MAIN_THREAD_BINDING("destroyTextCache", Wrap_DestroyTextCache);
+  EXPORT_MAIN_THREAD_BINDING("clearTextCache", Wrap_ClearTextCache);
+  EXPORT_MAIN_THREAD_BINDING("renderCachedText", Wrap_RenderCachedText);
+  EXPORT_MAIN_THREAD_BINDING("getTextCacheStats", Wrap_GetTextCacheStats);
+  EXPORT_MAIN_THREAD_BINDING("createDisplayList", Wrap_CreateDisplayList);
+  EXPORT_MAIN_THREAD_BINDING("destroyDisplayList", Wrap_DestroyDisplayList);
+  EXPORT_MAIN_THREAD_BINDING("displayListSet", Wrap_DisplayListSet);
+  EXPORT_MAIN_THREAD_BINDING("displayListRemove", Wrap_DisplayListRemove);
+  EXPORT_MAIN_THREAD_BINDING("clearDisplayList", Wrap_ClearDisplayList);
+  EXPORT_MAIN_THREAD_BINDING("invalidateDisplayList", Wrap_InvalidateDisplayList);
+  EXPORT_MAIN_THREAD_BINDING("renderDisplayList", Wrap_RenderDisplayList);
+  EXPORT_MAIN_THREAD_BINDING("getDisplayListStats", Wrap_GetDisplayListStats);
+  EXPORT_MAIN_THREAD_BINDING("pollEvent", Wrap_SDL_PollEvent);
+  EXPORT_MAIN_THREAD_BINDING("pollEvents", Wrap_SDL_PollEvents);
+  EXPORT_MAIN_THREAD_BINDING("setEventFilter", Wrap_SetEventFilter);
+  EXPORT_MAIN_THREAD_BINDING("getEventFilterStats", Wrap_GetEventFilterStats);
+  EXPORT_MAIN_THREAD_BINDING("setEventEnabled", Wrap_SDL_SetEventEnabled);
+  EXPORT_MAIN_THREAD_BINDING("eventEnabled", Wrap_SDL_EventEnabled);
+  EXPORT_BINDING("pushEvent", Wrap_SDL_PushEvent);
+  EXPORT_MAIN_THREAD_BINDING("waitEvent", Wrap_SDL_WaitEvent);
+  EXPORT_MAIN_THREAD_BINDING("events", Wrap_Events);
+  EXPORT_MAIN_THREAD_BINDING("setEventPumpInterval", Wrap_SetEventPumpInterval);
+  EXPORT_MAIN_THREAD_BINDING("getEventPumpStats", Wrap_GetEventPumpStats);
+  EXPORT_MAIN_THREAD_BINDING("startFrameLoop", Wrap_StartFrameLoop);
+  EXPORT_MAIN_THREAD_BINDING("stopFrameLoop", Wrap_StopFrameLoop);
+  EXPORT_MAIN_THREAD_BINDING("getFrameLoopStats", Wrap_GetFrameLoopStats);
+
+  // Surface functions
+  EXPORT_BINDING("createSurface", Wrap_SDL_CreateSurface);
+  EXPORT_BINDING("createSurfaceFrom", Wrap_SDL_CreateSurfaceFrom);
+  EXPORT_BINDING("destroySurface", Wrap_SDL_DestroySurface);
+  EXPORT_BINDING("getSurfaceInfo", Wrap_GetSurfaceInfo);
+  EXPORT_BINDING("blitSurface", Wrap_SDL_BlitSurface);
+  EXPORT_BINDING("blitSurfaceScaled", Wrap_SDL_BlitSurfaceScaled);
+  EXPORT_BINDING("fillSurfaceRects", Wrap_SDL_FillSurfaceRects);
+  EXPORT_BINDING("convertPixels", Wrap_SDL_ConvertPixels);
+  EXPORT_BINDING("premultiplyAlpha", Wrap_SDL_PremultiplyAlpha);
+  EXPORT_BINDING("blitSurfaceAsync", Wrap_BlitSurfaceAsync);
+  EXPORT_BINDING("blitSurfaceScaledAsync", Wrap_BlitSurfaceScaledAsync);
+  EXPORT_BINDING("convertPixelsAsync", Wrap_ConvertPixelsAsync);
+  EXPORT_BINDING("premultiplyAlphaAsync", Wrap_PremultiplyAlphaAsync);
 
   // Audio device functions
-  exports.Set("openAudioDevice", Function::New(env, Wrap_SDL_OpenAudioDevice));
-  exports.Set("closeAudioDevice", Function::New(env, Wrap_SDL_CloseAudioDevice));
-  exports.Set("getAudioDeviceName", Function::New(env, Wrap_SDL_GetAudioDeviceName));
-  exports.Set("pauseAudioDevice", Function::New(env, Wrap_SDL_PauseAudioDevice));
-  exports.Set("resumeAudioDevice", Function::New(env, Wrap_SDL_ResumeAudioDevice));
-  exports.Set("audioDevicePaused", Function::New(env, Wrap_SDL_AudioDevicePaused));
-  exports.Set("setAudioDeviceGain", Function::New(env, Wrap_SDL_SetAudioDeviceGain));
-  exports.Set("getAudioDeviceGain", Function::New(env, Wrap_SDL_GetAudioDeviceGain));
+  EXPORT_BINDING("openAudioDevice", Wrap_SDL_OpenAudioDevice);
+  EXPORT_BINDING("closeAudioDevice", Wrap_SDL_CloseAudioDevice);
+  EXPORT_BINDING("getAudioDeviceName", Wrap_SDL_GetAudioDeviceName);
+  EXPORT_BINDING("pauseAudioDevice", Wrap_SDL_PauseAudioDevice);
+  EXPORT_BINDING("resumeAudioDevice", Wrap_SDL_ResumeAudioDevice);
+  EXPORT_BINDING("audioDevicePaused", Wrap_SDL_AudioDevicePaused);
+  EXPORT_BINDING("setAudioDeviceGain", Wrap_SDL_SetAudioDeviceGain);
+  EXPORT_BINDING("getAudioDeviceGain", Wrap_SDL_GetAudioDeviceGain);
 
   // Audio stream functions
-  exports.Set("createAudioStream", Function::New(env, Wrap_SDL_CreateAudioStream));
-  exports.Set("destroyAudioStream", Function::New(env, Wrap_SDL_DestroyAudioStream));
-  exports.Set("bindAudioStream", Function::New(env, Wrap_SDL_BindAudioStream));
-  exports.Set("unbindAudioStream", Function::New(env, Wrap_SDL_UnbindAudioStream));
-  exports.Set("putAudioStreamData", Function::New(env, Wrap_SDL_PutAudioStreamData));
-  exports.Set("getAudioStreamData", Function::New(env, Wrap_SDL_GetAudioStreamData));
-  exports.Set("getAudioStreamAvailable", Function::New(env, Wrap_SDL_GetAudioStreamAvailable));
-  exports.Set("flushAudioStream", Function::New(env, Wrap_SDL_FlushAudioStream));
-  exports.Set("clearAudioStream", Function::New(env, Wrap_SDL_ClearAudioStream));
-  exports.Set("loadWAV", Function::New(env, Wrap_SDL_LoadWAV));
+  EXPORT_BINDING("createAudioStream", Wrap_SDL_CreateAudioStream);
+  EXPORT_BINDING("destroyAudioStream", Wrap_SDL_DestroyAudioStream);
+  EXPORT_BINDING("bindAudioStream", Wrap_SDL_BindAudioStream);
+  EXPORT_BINDING("unbindAudioStream", Wrap_SDL_UnbindAudioStream);
+  EXPORT_BINDING("putAudioStreamData", Wrap_SDL_PutAudioStreamData);
+  EXPORT_BINDING("getAudioStreamData", Wrap_SDL_GetAudioStreamData);
+  EXPORT_BINDING("getAudioStreamAvailable", Wrap_SDL_GetAudioStreamAvailable);
+  EXPORT_BINDING("flushAudioStream", Wrap_SDL_FlushAudioStream);
+  EXPORT_BINDING("clearAudioStream", Wrap_SDL_ClearAudioStream);
+  EXPORT_BINDING("loadWAV", Wrap_SDL_LoadWAV);
+  EXPORT_BINDING("loadWAVAsync", Wrap_LoadWAVAsync);
+  EXPORT_BINDING("clearWAVCache", Wrap_ClearWAVCache);
+  EXPORT_BINDING("setWAVCacheLimit", Wrap_SetWAVCacheLimit);
+  EXPORT_BINDING("getWAVCacheStats", Wrap_GetWAVCacheStats);
+  EXPORT_BINDING("convertAudio", Wrap_ConvertAudio);
+  EXPORT_BINDING("convertAudioBatch", Wrap_ConvertAudioBatch);
+
+  // Pull-mode audio stream functions
+  EXPORT_BINDING("enableAudioStreamPull", Wrap_EnableAudioStreamPull);
+  EXPORT_BINDING("disableAudioStreamPull", Wrap_DisableAudioStreamPull);
+  EXPORT_BINDING("writeAudioStreamPull", Wrap_WriteAudioStreamPull);
+  EXPORT_BINDING("setAudioStreamPullLowWater", Wrap_SetAudioStreamPullLowWater);
+  EXPORT_BINDING("getAudioStreamPullStats", Wrap_GetAudioStreamPullStats);
+  EXPORT_BINDING("enableAudioStreamMonitor", Wrap_EnableAudioStreamMonitor);
+  EXPORT_BINDING("disableAudioStreamMonitor", Wrap_DisableAudioStreamMonitor);
+  EXPORT_BINDING("setAudioStreamTargetLatency", Wrap_SetAudioStreamTargetLatency);
+  EXPORT_BINDING("getAudioStreamMonitorStats", Wrap_GetAudioStreamMonitorStats);
+
+  // Audio capture functions
+  EXPORT_BINDING("enableAudioStreamCapture", Wrap_EnableAudioStreamCapture);
+  EXPORT_BINDING("disableAudioStreamCapture", Wrap_DisableAudioStreamCapture);
+  EXPORT_BINDING("getAudioStreamCaptureStats", Wrap_GetAudioStreamCaptureStats);
+
+  // Mixer functions
+  EXPORT_BINDING("createMixer", Wrap_CreateMixer);
+  EXPORT_BINDING("destroyMixer", Wrap_DestroyMixer);
+  EXPORT_BINDING("mixerAddSound", Wrap_MixerAddSound);
+  EXPORT_BINDING("mixerRemoveSound", Wrap_MixerRemoveSound);
+  EXPORT_BINDING("mixerPlay", Wrap_MixerPlay);
+  EXPORT_BINDING("mixerStop", Wrap_MixerStop);
+  EXPORT_BINDING("mixerSetVoice", Wrap_MixerSetVoice);
+  EXPORT_BINDING("getMixerStats", Wrap_GetMixerStats);
+
+  // Instrumentation, left unprofiled so snapshots don't perturb the numbers
+  exports.Set("setStatsEnabled", Function::New(env, Wrap_SetStatsEnabled));
+  exports.Set("resetStats", Function::New(env, Wrap_ResetStats));
+  exports.Set("getStatsLayout", Function::New(env, Wrap_GetStatsLayout));
+  exports.Set("getStats", Function::New(env, Wrap_GetStats));
 
   // Export SDL constants
   exports.Set("INIT_VIDEO", Number::New(env, SDL_INIT_VIDEO));
@@ -550,6 +5962,67 @@ Object Init (Env env, Object exports) {
   exports.Set("WINDOW_RESIZABLE", Number::New(env, SDL_WINDOW_RESIZABLE));
   exports.Set("EVENT_QUIT", Number::New(env, SDL_EVENT_QUIT));
 
+  // Event types and record layout used by pollEvents
+  exports.Set("EVENT_RECORD_SIZE", Number::New(env, sizeof(EventRecord)));
+  exports.Set("EVENT_WINDOW_FIRST", Number::New(env, SDL_EVENT_WINDOW_FIRST));
+  exports.Set("EVENT_WINDOW_LAST", Number::New(env, SDL_EVENT_WINDOW_LAST));
+  exports.Set("EVENT_WINDOW_MOVED", Number::New(env, SDL_EVENT_WINDOW_MOVED));
+  exports.Set("EVENT_WINDOW_RESIZED", Number::New(env, SDL_EVENT_WINDOW_RESIZED));
+  exports.Set("EVENT_WINDOW_PIXEL_SIZE_CHANGED", Number::New(env, SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED));
+  exports.Set("EVENT_KEY_DOWN", Number::New(env, SDL_EVENT_KEY_DOWN));
+  exports.Set("EVENT_KEY_UP", Number::New(env, SDL_EVENT_KEY_UP));
+  exports.Set("EVENT_MOUSE_MOTION", Number::New(env, SDL_EVENT_MOUSE_MOTION));
+  exports.Set("EVENT_MOUSE_BUTTON_DOWN", Number::New(env, SDL_EVENT_MOUSE_BUTTON_DOWN));
+  exports.Set("EVENT_MOUSE_BUTTON_UP", Number::New(env, SDL_EVENT_MOUSE_BUTTON_UP));
+  exports.Set("EVENT_MOUSE_WHEEL", Number::New(env, SDL_EVENT_MOUSE_WHEEL));
+  exports.Set("EVENT_FINGER_DOWN", Number::New(env, SDL_EVENT_FINGER_DOWN));
+  exports.Set("EVENT_FINGER_UP", Number::New(env, SDL_EVENT_FINGER_UP));
+  exports.Set("EVENT_FINGER_MOTION", Number::New(env, SDL_EVENT_FINGER_MOTION));
+  exports.Set("EVENT_AUDIO_DEVICE_ADDED", Number::New(env, SDL_EVENT_AUDIO_DEVICE_ADDED));
+  exports.Set("EVENT_AUDIO_DEVICE_REMOVED", Number::New(env, SDL_EVENT_AUDIO_DEVICE_REMOVED));
+  exports.Set("EVENT_USER", Number::New(env, SDL_EVENT_USER));
+
+  // Texture access and pixel formats
+  exports.Set("TEXTUREACCESS_STATIC", Number::New(env, SDL_TEXTUREACCESS_STATIC));
+  exports.Set("TEXTUREACCESS_STREAMING", Number::New(env, SDL_TEXTUREACCESS_STREAMING));
+  exports.Set("TEXTUREACCESS_TARGET", Number::New(env, SDL_TEXTUREACCESS_TARGET));
+  exports.Set("PIXELFORMAT_ARGB8888", Number::New(env, SDL_PIXELFORMAT_ARGB8888));
+  exports.Set("PIXELFORMAT_ABGR8888", Number::New(env, SDL_PIXELFORMAT_ABGR8888));
+  exports.Set("PIXELFORMAT_RGBA8888", Number::New(env, SDL_PIXELFORMAT_RGBA8888));
+  exports.Set("PIXELFORMAT_BGRA8888", Number::New(env, SDL_PIXELFORMAT_BGRA8888));
+  exports.Set("PIXELFORMAT_XRGB8888", Number::New(env, SDL_PIXELFORMAT_XRGB8888));
+  exports.Set("PIXELFORMAT_RGB24", Number::New(env, SDL_PIXELFORMAT_RGB24));
+  exports.Set("PIXELFORMAT_RGBA32", Number::New(env, SDL_PIXELFORMAT_RGBA32));
+  exports.Set("PIXELFORMAT_IYUV", Number::New(env, SDL_PIXELFORMAT_IYUV));
+  exports.Set("PIXELFORMAT_YV12", Number::New(env, SDL_PIXELFORMAT_YV12));
+  exports.Set("PIXELFORMAT_NV12", Number::New(env, SDL_PIXELFORMAT_NV12));
+
+  // Surface scale modes
+  exports.Set("SCALEMODE_NEAREST", Number::New(env, SDL_SCALEMODE_NEAREST));
+  exports.Set("SCALEMODE_LINEAR", Number::New(env, SDL_SCALEMODE_LINEAR));
+
+  // Geometry and sprite record sizes, in elements
+  exports.Set("GEOMETRY_VERTEX_SIZE", Number::New(env, kGeometryVertexFloats));
+  exports.Set("SPRITE_RECORD_SIZE", Number::New(env, kSpriteRecordDoubles));
+  exports.Set("TEXT_RECORD_SIZE", Number::New(env, kTextRecordFloats));
+  exports.Set("DISPLAY_NODE_RECT", Number::New(env, DISPLAY_NODE_RECT));
+  exports.Set("DISPLAY_NODE_FILL_RECT", Number::New(env, DISPLAY_NODE_FILL_RECT));
+  exports.Set("DISPLAY_NODE_LINE", Number::New(env, DISPLAY_NODE_LINE));
+  exports.Set("DISPLAY_NODE_TEXTURE", Number::New(env, DISPLAY_NODE_TEXTURE));
+  exports.Set("DISPLAY_NODE_TEXT", Number::New(env, DISPLAY_NODE_TEXT));
+  exports.Set("DEBUG_TEXT_FONT_CHARACTER_SIZE", Number::New(env, SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE));
+
+  // Render command opcodes
+  exports.Set("RENDER_CMD_COLOR", Number::New(env, RENDER_CMD_COLOR));
+  exports.Set("RENDER_CMD_CLEAR", Number::New(env, RENDER_CMD_CLEAR));
+  exports.Set("RENDER_CMD_RECT", Number::New(env, RENDER_CMD_RECT));
+  exports.Set("RENDER_CMD_FILL_RECT", Number::New(env, RENDER_CMD_FILL_RECT));
+  exports.Set("RENDER_CMD_LINE", Number::New(env, RENDER_CMD_LINE));
+  exports.Set("RENDER_CMD_POINT", Number::New(env, RENDER_CMD_POINT));
+  exports.Set("RENDER_CMD_PRESENT", Number::New(env, RENDER_CMD_PRESENT));
+  exports.Set("RENDER_CMD_CLIP", Number::New(env, RENDER_CMD_CLIP));
+  exports.Set("RENDER_CMD_VIEWPORT", Number::New(env, RENDER_CMD_VIEWPORT));
+
   // Audio constants
   exports.Set("AUDIO_DEVICE_DEFAULT_PLAYBACK", Number::New(env, SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK));
   exports.Set("AUDIO_DEVICE_DEFAULT_RECORDING", Number::New(env, SDL_AUDIO_DEVICE_DEFAULT_RECORDING));